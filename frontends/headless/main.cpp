@@ -0,0 +1,291 @@
+#include "../../include/audio.h"
+#include "../../include/chip8.h"
+#include "../../include/defines.h"
+#include "../../include/rom_database.h"
+#include "../../include/sha1.h"
+#include "../../include/mapped_file.h"
+#include "../../include/snapshot.h"
+#include "../../include/movie.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// headless: runs a ROM for a fixed number of frames with no window, audio
+// or input and reports where it ended up, for scripts and batch workers
+//
+//   headless -r <rom> [-d index] [-n frames] [-v variant] [-q quirks] [-e seed] [-i cycles] [-b address] [-x]
+//            [-a directory -w frames]
+//   headless -m <movie> [-g frame] [-n frames] [-b address] [-x]
+//
+// -r - reads the ROM from stdin, -n defaults to 600 frames (10 emulated
+// seconds). -d takes the ROM's variant, quirks and instructions per frame
+// from an index built by tools/romdb, -v, -q and -i override them. -b
+// stops at a hex address and -x prints the final screen. -a caches the state after the first -w
+// frames of the run in the directory, later runs of the ROM with the same
+// settings start from it instead of running the boot frames again. the
+// exit status is 1 when a stack fault or an unknown opcode ended the run.
+// -m replays an input movie instead, from its frame -g (0 by default) to
+// its end or for -n frames
+
+#define HEADLESS_FRAMES 600
+
+const char *option(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+    }
+    return nullptr;
+}
+
+bool flag(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// the whole ROM in memory for hashing and loading, regular files are
+// mapped, stdin (-) and pipes are read
+bool readROM(const char *path, MappedFile &mapped, std::vector<u8> &piped, const u8 *&rom, size_t &size)
+{
+    if (strcmp(path, "-") != 0 && mapped.open(path))
+    {
+        rom = mapped.data();
+        size = mapped.size();
+        return true;
+    }
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!file)
+        return false;
+    u8 chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        piped.insert(piped.end(), chunk, chunk + count);
+    if (file != stdin)
+        fclose(file);
+    rom = piped.data();
+    size = piped.size();
+    return true;
+}
+
+// runs frames till end, with the movie's keys if there is one, reporting the
+// sound timer of each frame to audio before it ticks. returns what
+// stopped the run early, a breakpoint or a fault, and FRAME if nothing did.
+// frame then counts the frame it stopped in
+StopReason runFrames(Chip8 &chip8, Audio &audio, long &frame, long end, int cycles_per_frame, u64 &instructions,
+                      const Movie *movie)
+{
+    // as fast as the host goes, the timers still tick once per emulated frame
+    for (; frame < end; frame++)
+    {
+        if (movie)
+        {
+            u16 keys = movie->keys((u64)frame);
+            for (int k = 0; k < KEYPAD_SIZE; k++)
+                chip8.keypad[k] = (keys >> k) & 1u;
+        }
+        RunResult result = chip8.runFrame(cycles_per_frame);
+        audio.setTimer(chip8.soundTimer());
+        if (chip8.audioPattern())
+            audio.setPattern(chip8.audioPattern(), chip8.audioPitch());
+        chip8.updateTimers();
+        instructions += result.cycles;
+        if (result.reason == StopReason::BREAKPOINT)
+        {
+            printf("[OK] Breakpoint reached in frame %ld\n", frame);
+            frame++;
+            return result.reason;
+        }
+        if (result.reason == StopReason::STACK_FAULT || result.reason == StopReason::ILLEGAL_OPCODE)
+        {
+            // 2NNN on a full stack or 00EE on an empty one
+            const char *fault = result.reason == StopReason::ILLEGAL_OPCODE ? "Unknown opcode"
+                                : chip8.registers().opcode == 0x00EE ? "Stack underflow"
+                                                                     : "Stack overflow";
+            fprintf(stderr, "[FAILED] %s in frame %ld\n", fault, frame);
+            frame++;
+            return result.reason;
+        }
+    }
+    return StopReason::FRAME;
+}
+
+void printScreen(const Frame &display)
+{
+    static const char shades[4] = {'.', '#', '+', '@'};
+    for (int y = 0; y < display.height; y++)
+    {
+        for (int x = 0; x < display.width; x++)
+            putchar(shades[display.pixel(x, y)]);
+        putchar('\n');
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *rom = option(argc, argv, "-r");
+    const char *movie_path = option(argc, argv, "-m");
+    if (!rom && !movie_path)
+    {
+        fprintf(stderr, "usage: headless -r <rom> [-d index] [-n frames] [-v variant] [-q quirks] [-e seed] [-i cycles] [-b address] [-x] "
+                        "[-a directory -w frames]\n"
+                        "       headless -m <movie> [-g frame] [-n frames] [-b address] [-x]\n");
+        return 1;
+    }
+
+    // names are checked before anything runs, they are applied once the index was read
+    Variant variant = Variant::CHIP8;
+    if (option(argc, argv, "-v") && !variantFromName(option(argc, argv, "-v"), variant))
+    {
+        fprintf(stderr, "[FAILED] Unknown variant %s\n", option(argc, argv, "-v"));
+        return 1;
+    }
+    QuirkProfile quirks = defaultQuirks(variant);
+    if (option(argc, argv, "-q") && !quirksFromName(option(argc, argv, "-q"), quirks))
+    {
+        fprintf(stderr, "[FAILED] Unknown quirk profile %s\n", option(argc, argv, "-q"));
+        return 1;
+    }
+    long frames = option(argc, argv, "-n") ? atol(option(argc, argv, "-n")) : HEADLESS_FRAMES;
+    int cycles_per_frame = option(argc, argv, "-i") ? atoi(option(argc, argv, "-i")) : CYCLES_PER_FRAME;
+    u64 seed = option(argc, argv, "-e") ? strtoull(option(argc, argv, "-e"), nullptr, 0) : RNG_DEFAULT_SEED;
+
+    // a movie starts from its first keyframe, which holds the ROM, on the
+    // machine and at the speed it was recorded with
+    std::unique_ptr<Chip8> chip8;
+    Movie movie;
+    u8 rom_digest[SHA1_SIZE];
+    long frame = 0;
+    if (movie_path)
+    {
+        if (!movie.open(movie_path))
+        {
+            fprintf(stderr, "[FAILED] %s isn't a movie\n", movie_path);
+            return 1;
+        }
+        chip8 = createChip8(movie.variant(), movie.quirks());
+        cycles_per_frame = (int)movie.cyclesPerFrame();
+        frame = option(argc, argv, "-g") ? atol(option(argc, argv, "-g")) : 0;
+        auto seek_start = std::chrono::steady_clock::now();
+        if (frame < 0 || !movie.seek(*chip8, (u64)frame))
+        {
+            fprintf(stderr, "[FAILED] The movie has %llu frames, %ld is past its end\n",
+                    (unsigned long long)movie.frames(), frame);
+            return 1;
+        }
+        printf("[OK] Frame %ld of %llu reached in %.3fms\n", frame, (unsigned long long)movie.frames(),
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seek_start).count());
+        frames = option(argc, argv, "-n") ? frame + atol(option(argc, argv, "-n")) : (long)movie.frames();
+    }
+    else
+    {
+        MappedFile mapped;
+        std::vector<u8> piped;
+        const u8 *rom_data = nullptr;
+        size_t rom_size = 0;
+        if (!readROM(rom, mapped, piped, rom_data, rom_size))
+        {
+            fprintf(stderr, "[FAILED] Could't Load the ROM\n");
+            return 1;
+        }
+        sha1(rom_data, rom_size, rom_digest);
+
+        // ROM settings from the index (-d <index>) keyed by the SHA-1, the
+        // command line wins over them as in the emulator. there is no
+        // default index, a batch run only depends on its arguments
+        RomInfo info = defaultRomInfo(Variant::CHIP8);
+        RomDatabase database;
+        if (option(argc, argv, "-d"))
+        {
+            if (!database.open(option(argc, argv, "-d")))
+            {
+                fprintf(stderr, "[FAILED] Couldn't open the index %s\n", option(argc, argv, "-d"));
+                return 1;
+            }
+            if (database.lookup(rom_digest, info))
+                printf("[OK] ROM found in the index\n");
+        }
+        if (option(argc, argv, "-v"))
+        {
+            info.variant = variant;
+            info.quirks = quirks;
+        }
+        if (option(argc, argv, "-q"))
+            info.quirks = quirks;
+        if (!option(argc, argv, "-i"))
+            cycles_per_frame = info.cycles_per_frame;
+
+        chip8 = createChip8(info.variant, info.quirks);
+        chip8->seed(seed);
+        if (!chip8->loadROM(rom_data, rom_size))
+        {
+            fprintf(stderr, "[FAILED] Could't Load the ROM\n");
+            return 1;
+        }
+    }
+
+    // -b <address> ends the run when pc gets there
+    if (option(argc, argv, "-b"))
+        chip8->setBreakpoint((u32)strtoul(option(argc, argv, "-b"), nullptr, 16));
+
+    // -a <directory> -w <frames>: the boot frames come from the ROM's cached
+    // snapshot when it was taken with the same settings, and are run and
+    // cached otherwise. a boot stopped by a breakpoint or a fault isn't cached
+    auto start = std::chrono::steady_clock::now();
+    u64 instructions = 0;
+    long first = frame;                         // first frame run, the ones loaded don't count for the speed
+    StopReason stop = StopReason::FRAME;
+    NullAudio audio;                            // no sound, the frames still report it like the SDL frontend's
+    long boot = option(argc, argv, "-w") ? std::min(atol(option(argc, argv, "-w")), frames) : 0;
+    if (option(argc, argv, "-a") && boot > 0 && !movie_path)
+    {
+        std::string path = Snapshot::path(option(argc, argv, "-a"), rom_digest, "boot");
+        SnapshotInfo info = {(u64)boot, seed, (u32)cycles_per_frame};
+        Snapshot cached;
+        if (cached.open(path.c_str(), rom_digest) && cached.info().frame == info.frame &&
+            cached.info().seed == info.seed && cached.info().cycles_per_frame == info.cycles_per_frame &&
+            cached.restore(*chip8))
+        {
+            frame = first = boot;
+            printf("[OK] %ld boot frames loaded from %s\n", boot, path.c_str());
+        }
+        else
+        {
+            cached.close();
+            stop = runFrames(*chip8, audio, frame, boot, cycles_per_frame, instructions, nullptr);
+            if (stop == StopReason::FRAME && !Snapshot::write(path.c_str(), *chip8, rom_digest, info))
+                fprintf(stderr, "[FAILED] Couldn't write %s\n", path.c_str());
+        }
+    }
+    if (stop == StopReason::FRAME)
+        stop = runFrames(*chip8, audio, frame, frames, cycles_per_frame, instructions, movie_path ? &movie : nullptr);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // the screen digest identifies the end state, same ROM, settings and seed same digest
+    u8 digest[SHA1_SIZE];
+    sha1((const u8 *)chip8->display.planes, sizeof(chip8->display.planes), digest);
+    char hex[SHA1_SIZE * 2 + 1];
+    for (int i = 0; i < SHA1_SIZE; i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+
+    // out of range accesses wrapped around instead of stopping the run
+    if (chip8->fault() == Fault::MEMORY)
+        fprintf(stderr, "[FAILED] The ROM accessed memory past its end\n");
+    if (flag(argc, argv, "-x"))
+        printScreen(chip8->display);
+    printf("[OK] %ld frames, %llu instructions in %.3fs (%.0f frames/s), screen %dx%d %s\n", frame,
+           (unsigned long long)instructions, seconds, seconds > 0 ? (frame - first) / seconds : 0.0, chip8->display.width,
+           chip8->display.height, hex);
+
+    // batch workers only see the exit status, a faulted run isn't a good one
+    bool ok = stop != StopReason::STACK_FAULT && stop != StopReason::ILLEGAL_OPCODE;
+    return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "sdl_audio.h"
+#include <cmath>
+#include <cstring>
+
+SDLAudio::SDLAudio() : device(0), timer(0), last_timer(0), remaining(0), phase(0),
+                       use_pattern(false), position(0), step(0)
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+    {
+        return;
+    }
+
+    SDL_AudioSpec want;
+    SDL_zero(want);
+    want.freq = AUDIO_RATE;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = AUDIO_SAMPLES;
+    want.callback = SDLAudio::callback;
+    want.userdata = this;
+
+    // no allowed changes, fill() always produces mono 16-bit at AUDIO_RATE
+    device = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
+    if (device)
+    {
+        SDL_PauseAudioDevice(device, 0);
+    }
+}
+
+bool SDLAudio::isOpen() const
+{
+    return device != 0;
+}
+
+// lock free, safe to call from the emulation thread every frame
+void SDLAudio::setTimer(u8 value)
+{
+    timer.store(value, std::memory_order_relaxed);
+}
+
+// lock free as well, the pattern is handed over through a triple buffer
+void SDLAudio::setPattern(const u8 *bytes, u8 pitch)
+{
+    Pattern &pattern = patterns.writeBuffer();
+    memcpy(pattern.bytes, bytes, PATTERN_SIZE);
+    pattern.pitch = pitch;
+    patterns.publish();
+}
+
+void SDLAudio::callback(void *userdata, Uint8 *stream, int len)
+{
+    ((SDLAudio *)userdata)->fill((i16 *)stream, len / (int)sizeof(i16));
+}
+
+// the tone lasts exactly timer/TIMER_HZ seconds worth of samples counted from
+// the last value seen, so the output doesn't depend on when the emulation runs
+void SDLAudio::fill(i16 *samples, int count)
+{
+    u8 value = timer.load(std::memory_order_relaxed);
+    if (value != last_timer)
+    {
+        remaining = (u32)value * (AUDIO_RATE / TIMER_HZ);
+        last_timer = value;
+    }
+
+    if (patterns.update())
+    {
+        // XO-CHIP plays 4000 * 2^((pitch - 64) / 48) pattern bits per second
+        use_pattern = true;
+        step = 4000.0 * pow(2.0, (patterns.readBuffer().pitch - 64) / 48.0) / AUDIO_RATE;
+    }
+
+    const u32 period = AUDIO_RATE / BUZZER_HZ;
+    for (int i = 0; i < count; i++)
+    {
+        if (remaining && use_pattern)
+        {
+            const u8 *bytes = patterns.readBuffer().bytes;
+            int bit = (int)position;
+            samples[i] = ((bytes[bit >> 3] >> (7 - (bit & 7))) & 1u) ? BUZZER_VOLUME : -BUZZER_VOLUME;
+            position = fmod(position + step, PATTERN_SIZE * 8);
+            remaining--;
+        }
+        else if (remaining)
+        {
+            samples[i] = (phase < period / 2) ? BUZZER_VOLUME : -BUZZER_VOLUME;
+            phase = (phase + 1) % period;
+            remaining--;
+        }
+        else
+        {
+            samples[i] = 0;
+            phase = 0;
+        }
+    }
+}
+
+SDLAudio::~SDLAudio()
+{
+    if (device)
+    {
+        SDL_CloseAudioDevice(device);
+    }
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
\ No newline at end of file
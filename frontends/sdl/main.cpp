@@ -0,0 +1,498 @@
+#include <iostream>
+#include "../../include/chip8.h"
+#include "../../include/defines.h"
+#include "../../include/platform.h"
+#include "sdl_audio.h"
+#include "../../include/triple_buffer.h"
+#include "../../include/spsc_queue.h"
+#include "../../include/rom_database.h"
+#include "../../include/mapped_file.h"
+#include "../../include/capture.h"
+#include "../../include/frame_clock.h"
+#include "../../include/snapshot.h"
+#include "../../include/movie.h"
+#include <atomic>
+#include <chrono>
+#include <thread>   // emulation thread
+#include <limits>   // For std::numeric_limits
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#undef main
+
+#define UI_WAIT_MS 4                            // longest the UI thread sleeps on the event queue
+#define ROMDB_PATH "../ROMs/roms.db"            // built from ROMs/romdb.txt by tools/romdb
+#define SNAPSHOT_DIR "../saves"                 // session snapshots, one per ROM
+#define SNAPSHOT_EVERY (10 * TIMER_HZ)          // frames between two session snapshots, on top of the one on exit
+
+std::string games[] = {"invaders", "tetris", "pumpkin", "danm8ku", "rocket2", "ibm", "brix"};
+int list_size = 7;
+
+#define TURBO_RENDER_EVERY 4                    // turbo publishes one emulated frame out of this many
+
+// state shared by the emulation and the UI threads, nothing here takes a lock
+struct Shared
+{
+    TripleBuffer<Frame> frames;                 // emulation -> UI, display at the end of the last frame that drew
+    SpscQueue<u16, 64> keys;                    // UI -> emulation, keypad bitmasks
+    std::atomic<bool> quit{false};
+    std::atomic<bool> turbo{false};             // UI -> emulation, fast forward, read every frame
+};
+
+// fast forward settings and what it achieved, the counters are only
+// written by the emulation thread and read after it joined
+struct Turbo
+{
+    u32 speed;                                  // emulated frames per 60Hz tick, 0 runs unthrottled
+    u32 render_every;                           // publish every Kth emulated frame, 0 never
+    u64 frames;                                 // emulated frames run in turbo
+    double seconds;                             // wall time spent in turbo
+};
+
+// quick resume: the session is saved every SNAPSHOT_EVERY frames by the
+// emulation thread, which owns the chip, through a background writer, and
+// on exit. no path when the ROM came from stdin, there is nothing to key
+// the snapshot on
+struct Session
+{
+    std::string path;
+    u8 digest[SHA1_SIZE];                       // SHA-1 of the ROM
+    SnapshotInfo info;                          // info.frame counts the resumed sessions' frames too
+    u64 saved;                                  // info.frame when the last snapshot was submitted
+    SnapshotWriter snapshots;                   // writes the periodic snapshots off the emulation thread
+    MovieWriter movie;                          // -m <file>, the keys of every frame
+};
+
+// one emulated frame: the instructions, cycles_per_frame of them or the VIP
+// frame's machine cycles in the vip-timed profile, then the timers which
+// tick even while the chip waits for a key. sound is the sound timer before
+// the tick, so ST=1 still sounds for its frame. returns true if anything was drawn
+bool runFrame(Chip8 &chip8, int cycles_per_frame, u8 &sound)
+{
+    bool dirty = chip8.runFrame(cycles_per_frame).drew;
+    sound = chip8.soundTimer();
+    chip8.updateTimers();
+    return dirty;
+}
+
+// emulation thread: runs cycles_per_frame instructions every 1/TIMER_HZ
+// and never touches SDL, so presenting can't stall it
+void emulate(Chip8 &chip8, Shared &shared, Audio &audio, Capture &capture, FrameClock &clock, Turbo &turbo,
+             Session &session, int cycles_per_frame)
+{
+    const auto tick = std::chrono::microseconds(1000000 / TIMER_HZ);
+    auto last_publish = std::chrono::steady_clock::now();
+    bool dirty = false;
+    bool behind = false;
+    bool was_unthrottled = false;
+    u64 frame = 0;
+    u16 held = 0;                               // keypad bitmask, as recorded in the movie
+    u8 sound = 0;                               // sound timer of the last frame run
+
+    clock.start();
+    while (!shared.quit.load(std::memory_order_relaxed))
+    {
+        // apply keypad changes sent by the UI thread
+        u16 keys;
+        while (shared.keys.pop(keys))
+        {
+            for (int i = 0; i < KEYPAD_SIZE; i++)
+                chip8.keypad[i] = (keys >> i) & 1u;
+            held = keys;
+        }
+
+        // checked once per tick, so switching takes effect within a frame
+        bool fast = shared.turbo.load(std::memory_order_relaxed);
+        bool unthrottled = fast && turbo.speed == 0;
+        if (was_unthrottled && !unthrottled)
+            clock.start();
+        was_unthrottled = unthrottled;
+
+        auto started = std::chrono::steady_clock::now();
+        u32 frames = (fast && turbo.speed) ? turbo.speed : 1;
+        for (u32 f = 0; f < frames; f++, frame++)
+        {
+            session.movie.record(chip8, held);
+            dirty |= runFrame(chip8, cycles_per_frame, sound);
+
+            // only the display as it is at the end of the frame is shown, however
+            // many DXYN ran, so half erased sprites never reach the screen. in
+            // turbo only every Kth frame is, none while the host is behind, and
+            // unthrottled no more than the screen can show
+            bool publish = dirty;
+            if (fast)
+            {
+                publish &= turbo.render_every && frame % turbo.render_every == 0 && !behind;
+                if (unthrottled)
+                    publish &= std::chrono::steady_clock::now() - last_publish >= tick;
+            }
+            if (publish)
+            {
+                shared.frames.writeBuffer() = chip8.display;
+                shared.frames.publish();
+                last_publish = std::chrono::steady_clock::now();
+                dirty = false;
+            }
+
+            // one captured frame per emulated frame, queued for the encoder thread
+            if (capture.isOpen())
+                capture.submit(chip8.display);
+        }
+        session.info.frame += frames;
+
+        // the state is copied and written by another thread, at most once
+        // per tick however fast turbo goes
+        if (!session.path.empty() && session.info.frame - session.saved >= SNAPSHOT_EVERY)
+        {
+            session.snapshots.submit(session.path, chip8, session.digest, session.info);
+            session.saved = session.info.frame;
+        }
+
+        // fast forward is silent
+        audio.setTimer(fast ? 0 : sound);
+        if (chip8.audioPattern())
+            audio.setPattern(chip8.audioPattern(), chip8.audioPitch());
+
+        if (!unthrottled)
+            behind = !clock.wait();
+        if (fast)
+        {
+            turbo.frames += frames;
+            turbo.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        }
+    }
+}
+
+// frame pacing summary, the histogram only lists the buckets that were hit
+void printJitter(const JitterStats &stats)
+{
+    std::cout << "[OK] " << stats.frames << " frames, " << stats.overruns << " overruns, "
+              << stats.max_us << "us max jitter\n";
+    for (int i = 0; i < JITTER_BUCKETS; i++)
+    {
+        if (!stats.buckets[i])
+            continue;
+        if (i == 0)
+            std::cout << "     < 1us: ";
+        else if (i == JITTER_BUCKETS - 1)
+            std::cout << "     >= " << (1ull << (i - 1)) << "us: ";
+        else
+            std::cout << "     < " << (1ull << i) << "us: ";
+        std::cout << stats.buckets[i] << "\n";
+    }
+}
+
+// binds the thread to one cpu, returns false where that isn't supported
+bool pinThread(std::thread &thread, int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    (void)cpu;
+    return false;
+#endif
+}
+
+// value following a command line option, nullptr if the option isn't there
+const char *option(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+    }
+    return nullptr;
+}
+
+// option without a value
+bool flag(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// path of the ROM the last session ran, written next to the snapshots
+bool readLastRom(const std::string &path, std::string &rom)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file)
+        return false;
+    char line[4096];
+    bool read = fgets(line, sizeof(line), file) != nullptr;
+    fclose(file);
+    if (!read)
+        return false;
+    line[strcspn(line, "\r\n")] = '\0';
+    rom = line;
+    return !rom.empty();
+}
+
+void writeLastRom(const std::string &path, const std::string &rom)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+        return;
+    fprintf(file, "%s\n", rom.c_str());
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    // getting the game, -r <rom> skips the menu and -r - reads it from stdin.
+    // without -r the last session's ROM is resumed, -n starts a new one
+    const char *snapshot_dir = option(argc, argv, "-a") ? option(argc, argv, "-a") : SNAPSHOT_DIR;
+    std::string last_rom = std::string(snapshot_dir) + "/last";
+    std::string file;
+    if (option(argc, argv, "-r"))
+    {
+        file = option(argc, argv, "-r");
+    }
+    else if (!flag(argc, argv, "-n") && readLastRom(last_rom, file))
+    {
+        std::cout << "[OK] Resuming " << file << "\n";
+    }
+    else
+    {
+        std::cout << "Pick the a game to execute, input a number [1-" << list_size << "]\n";
+        for (int i = 0; i < list_size; i++)
+            std::cout << (i + 1) << "- " << games[i] << "\n";
+        while (true)
+        {
+            int x;
+            std::cin >> x;
+            if (std::cin.fail() || x < 1 || x > 7)
+            {
+                std::cout << "Invalid input!\n";
+                std::cin.clear();
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+            else
+            {
+                file = "../ROMs/" + games[x - 1] + ".ch8";
+                break;
+            }
+        }
+    }
+
+    // the ROM bytes are hashed for the index then loaded from the same buffer,
+    // files are mapped and stdin is read once
+    MappedFile mapped;
+    std::vector<u8> piped;
+    const u8 *rom = nullptr;
+    size_t rom_size = 0;
+    if (file == "-")
+    {
+        u8 chunk[4096];
+        size_t count;
+        while ((count = fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+            piped.insert(piped.end(), chunk, chunk + count);
+        rom = piped.data();
+        rom_size = piped.size();
+    }
+    else if (mapped.open(file.c_str()))
+    {
+        rom = mapped.data();
+        rom_size = mapped.size();
+    }
+    if (!rom)
+    {
+        std::cerr << "[FAILED] Could't Load the ROM\n";
+        return 1;
+    }
+
+    // ROM settings from the index (-d <index>), keyed by the ROM's SHA-1
+    // like the session snapshots
+    Session session;
+    sha1(rom, rom_size, session.digest);
+    RomInfo info = defaultRomInfo(Variant::CHIP8);
+    RomDatabase database;
+    const char *database_path = option(argc, argv, "-d") ? option(argc, argv, "-d") : ROMDB_PATH;
+    if (database.open(database_path) && database.lookup(session.digest, info))
+        std::cout << "[OK] ROM found in the index\n";
+
+    // the command line wins over the index: -v schip/xochip picks an
+    // extended variant and -q default/vip/schip/xochip/vip-timed its quirk profile
+    if (option(argc, argv, "-v") && variantFromName(option(argc, argv, "-v"), info.variant))
+        info.quirks = defaultQuirks(info.variant);
+    if (option(argc, argv, "-q"))
+        quirksFromName(option(argc, argv, "-q"), info.quirks);
+
+    // initlizing the chip
+    std::cout << "[PENDING] Initializing CHIP-8\n";
+    std::unique_ptr<Chip8> chip8_ptr = createChip8(info.variant, info.quirks);
+    Chip8 &chip8 = *chip8_ptr;
+    u64 seed = RNG_DEFAULT_SEED;
+    if (option(argc, argv, "-e"))                 // -e <seed> reseeds CXNN's generator, fixed by default
+        seed = strtoull(option(argc, argv, "-e"), nullptr, 0);
+    chip8.seed(seed);
+    std::cout << "[OK] DONE!\n";
+
+    // loading the rom
+    std::cout << "[PENDING] Loading ROM...\n";
+    bool loaded = chip8.loadROM(rom, rom_size);
+    mapped.close();
+    if (!loaded)
+    {
+        std::cerr << "[FAILED] Could't Load the ROM\n";
+        return 1;
+    }
+    std::cout << "[OK] ROM Loaded Successfully!\n";
+
+    // quick resume: the ROM's snapshot in -a <directory> (../saves by
+    // default) is mapped and loaded over the fresh machine, -n ignores it
+    session.info = {0, seed, info.cycles_per_frame};
+    session.saved = 0;
+    if (file != "-")
+    {
+        session.path = Snapshot::path(snapshot_dir, session.digest, "resume");
+        Snapshot snapshot;
+        if (!flag(argc, argv, "-n") && snapshot.open(session.path.c_str(), session.digest))
+        {
+            if (snapshot.restore(chip8))
+            {
+                session.info.frame = session.saved = snapshot.info().frame;
+                std::cout << "[OK] Resumed at frame " << session.info.frame << "\n";
+            }
+            else
+            {
+                std::cerr << "[FAILED] The snapshot is of another variant or quirk profile, starting over\n";
+            }
+        }
+    }
+
+    // -m <file> records the keys of every frame to an input movie, a movie
+    // of this ROM already there is continued from its last frame
+    if (option(argc, argv, "-m"))
+    {
+        if (session.movie.open(option(argc, argv, "-m"), chip8, session.digest, info.cycles_per_frame, seed))
+            std::cout << "[OK] Recording inputs from frame " << session.movie.frames() << "\n";
+        else
+            std::cerr << "[FAILED] " << option(argc, argv, "-m") << " isn't a movie of this ROM and machine\n";
+    }
+
+    // setting the SDL window
+    std::cout << "[PENDING] Initializing Screen\n";
+    Platform platform;
+    std::cout << "[OK] Screen Initialized Successfully\n";
+
+    // falls back to silence if there is no audio device
+    SDLAudio sdl_audio;
+    NullAudio null_audio;
+    Audio &audio = sdl_audio.isOpen() ? (Audio &)sdl_audio : (Audio &)null_audio;
+    if (!sdl_audio.isOpen())
+        std::cerr << "[FAILED] Couldn't open the audio device, running muted\n";
+
+    // -o <file> records the screen, -f y4m/rgb/rle picks the format and -s the scale
+    Capture capture;
+    if (option(argc, argv, "-o"))
+    {
+        CaptureFormat format = CaptureFormat::Y4M;
+        if (option(argc, argv, "-f"))
+            captureFormatFromName(option(argc, argv, "-f"), format);
+        int scale = option(argc, argv, "-s") ? atoi(option(argc, argv, "-s")) : 1;
+        if (capture.open(option(argc, argv, "-o"), format, scale, palette))
+            std::cout << "[OK] Recording to " << option(argc, argv, "-o") << "\n";
+        else
+            std::cerr << "[FAILED] Couldn't record to " << option(argc, argv, "-o") << "\n";
+    }
+
+    // -p <us> spins that long before each deadline instead of sleeping
+    FrameClock clock(TIMER_HZ, option(argc, argv, "-p") ? (u32)atoi(option(argc, argv, "-p")) : 0);
+
+    // Tab toggles fast forward, -t <N> starts in it at N times the speed (0
+    // unthrottled) and -k <K> shows one frame out of K (0 none)
+    Turbo turbo = {0, TURBO_RENDER_EVERY, 0, 0.0};
+    if (option(argc, argv, "-t"))
+        turbo.speed = (u32)atoi(option(argc, argv, "-t"));
+    if (option(argc, argv, "-k"))
+        turbo.render_every = (u32)atoi(option(argc, argv, "-k"));
+
+    // emulation runs on its own thread, optionally pinned with -c <cpu>
+    Shared shared;
+    shared.turbo.store(option(argc, argv, "-t") != nullptr);
+    std::thread emulation(emulate, std::ref(chip8), std::ref(shared), std::ref(audio), std::ref(capture),
+                          std::ref(clock), std::ref(turbo), std::ref(session), (int)info.cycles_per_frame);
+    if (option(argc, argv, "-c"))
+    {
+        int cpu = atoi(option(argc, argv, "-c"));
+        if (pinThread(emulation, cpu))
+            std::cout << "[OK] Emulation pinned to cpu " << cpu << "\n";
+        else
+            std::cerr << "[FAILED] Couldn't pin emulation to cpu " << cpu << "\n";
+    }
+
+    // UI loop: forwards input and presents the latest published frame
+    u8 keypad[KEYPAD_SIZE] = {0};
+    u16 sent_keys = 0;
+    bool quit = false;
+    while (!quit)
+    {
+        quit = platform.waitInput(keypad, UI_WAIT_MS);
+        if (platform.turboToggled())
+            shared.turbo.store(!shared.turbo.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+        // the ROM's key mapping decides which chip-8 key each host key drives
+        u16 keys = 0;
+        for (int i = 0; i < KEYPAD_SIZE; i++)
+            keys |= (u16)((keypad[i] ? 1u : 0u) << info.keymap[i]);
+
+        // a full queue keeps the change pending till the next iteration
+        if (keys != sent_keys && shared.keys.push(keys))
+            sent_keys = keys;
+
+        // at most one new frame per 60Hz tick, and presenting waits for the
+        // host vsync so the screen is never drawn faster than it refreshes
+        if (shared.frames.update())
+            platform.updateScreen(shared.frames.readBuffer());
+    }
+
+    shared.quit.store(true, std::memory_order_relaxed);
+    emulation.join();
+    if (session.movie.isOpen())
+    {
+        std::cout << "[OK] Recorded " << session.movie.frames() << " frames of inputs\n";
+        session.movie.close();
+    }
+    if (!session.path.empty())
+    {
+        // the emulation thread is gone, the last snapshot is written here
+        // once a periodic one still in flight can't land over it
+        session.snapshots.flush();
+        if (Snapshot::write(session.path.c_str(), chip8, session.digest, session.info))
+        {
+            writeLastRom(last_rom, file);
+            std::cout << "[OK] Session saved to " << session.path << "\n";
+        }
+        else
+        {
+            std::cerr << "[FAILED] Couldn't save the session to " << session.path << "\n";
+        }
+    }
+    printJitter(clock.stats());
+    if (turbo.frames)
+    {
+        std::cout << "[OK] Turbo: " << turbo.frames << " frames in " << turbo.seconds << "s, "
+                  << turbo.frames / turbo.seconds / TIMER_HZ << "x real time\n";
+    }
+
+    if (capture.isOpen())
+    {
+        capture.close();
+        std::cout << "[OK] Recorded " << capture.written() << " frames, " << capture.dropped() << " dropped\n";
+    }
+
+    return 0;
+}
\ No newline at end of file
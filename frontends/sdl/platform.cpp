@@ -0,0 +1,102 @@
+#include "../../include/platform.h"
+
+Platform::Platform() : turbo_toggled(false)
+{
+    SDL_Init(SDL_INIT_VIDEO);
+
+    window = SDL_CreateWindow("CHIP-8++", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                              WINDOW_WIDTH, WINDOW_HEIGHT, 0);
+
+    // presents are synced to the host refresh, one per vblank at most
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                HIRES_WIDTH, HIRES_HEIGHT);
+}
+
+void Platform::updateScreen(const Frame &display)
+{
+    // both planes to palette colors in one vectorized pass
+    expandFrame(display, palette, 1, pixels, display.width);
+
+    // only the top left width * height part is used in lores
+    SDL_Rect source = {0, 0, display.width, display.height};
+    SDL_UpdateTexture(texture, &source, pixels, display.width * (int)sizeof(u32));
+
+    // stretched to the window, 8 window pixels per pixel in lores, 4 in hires
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, &source, nullptr);
+
+    // update the display
+    SDL_RenderPresent(renderer);
+}
+
+bool Platform::inputHandler(u8 *keypad)
+{
+    SDL_Event event;
+
+    bool quit = 0;
+
+    // drain every pending event, a frame may have queued several
+    while (SDL_PollEvent(&event))
+    {
+        quit |= handleEvent(event, keypad);
+    }
+    return quit;
+}
+
+// used while the chip is waiting for a key (FX0A): sleeps on the event
+// queue instead of spinning, returns on the first event or after timeout ms
+bool Platform::waitInput(u8 *keypad, u32 timeout)
+{
+    SDL_Event event;
+
+    if (!SDL_WaitEventTimeout(&event, (int)timeout))
+    {
+        return 0;
+    }
+
+    bool quit = handleEvent(event, keypad);
+    return inputHandler(keypad) || quit;
+}
+
+// true once for every Tab press since the last call
+bool Platform::turboToggled()
+{
+    bool toggled = turbo_toggled;
+    turbo_toggled = false;
+    return toggled;
+}
+
+bool Platform::handleEvent(const SDL_Event &event, u8 *keypad)
+{
+    if (event.type == SDL_QUIT)
+    {
+        return 1;
+    }
+
+    // Tab switches fast forward on and off, held down it doesn't repeat
+    if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_TAB && !event.key.repeat)
+    {
+        turbo_toggled = true;
+    }
+
+    auto keyboard_state = SDL_GetKeyboardState(nullptr);
+
+    // update chip8 keypad
+    for (int i = 0; i < KEYPAD_SIZE; i++)
+    {
+        // i will be on if the corresponding button is pressed
+        auto corresponding = keypad_to_keyboard[i];
+        keypad[i] = keyboard_state[corresponding];
+    }
+    return 0;
+}
+
+Platform::~Platform()
+{
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef _SDL_AUDIO_H
+#define _SDL_AUDIO_H
+
+#include <atomic>
+#include "../../include/audio.h"
+#include "../../include/defines.h"
+#include "../../include/triple_buffer.h"
+#include "../../3rdparty/inc/SDL.h"
+
+#define AUDIO_RATE     44100           // samples per second
+#define AUDIO_SAMPLES  512             // samples per callback, ~11ms of latency
+#define BUZZER_HZ      1400            // buzzer tone frequency
+#define BUZZER_VOLUME  3000            // square wave amplitude
+
+// SDL audio device generating a square wave from the timer inside the callback
+class SDLAudio : public Audio
+{
+public:
+    SDLAudio();
+    bool isOpen() const;                        // false if no device could be opened
+    void setTimer(u8) override;
+    void setPattern(const u8 *, u8) override;
+    ~SDLAudio();
+
+private:
+    static void callback(void *, Uint8 *, int);
+    void fill(i16 *, int);                      // generates samples on the audio thread
+
+    struct Pattern
+    {
+        u8 bytes[PATTERN_SIZE];
+        u8 pitch;
+    };
+
+    SDL_AudioDeviceID device;
+    std::atomic<u8> timer;                      // written by the emulation, read by the callback
+    TripleBuffer<Pattern> patterns;             // written by the emulation, read by the callback
+
+    // owned by the audio thread
+    u8 last_timer;                              // timer value the countdown was computed from
+    u32 remaining;                              // samples left before the tone stops
+    u32 phase;                                  // position inside the square wave period
+    bool use_pattern;                           // a pattern was received, the buzzer is replaced
+    double position;                            // bit being played inside the 128 bits pattern
+    double step;                                // pattern bits per output sample
+};
+
+#endif
\ No newline at end of file
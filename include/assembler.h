@@ -0,0 +1,34 @@
+#ifndef _ASSEMBLER_H
+#define _ASSEMBLER_H
+
+#include <string>
+#include <vector>
+#include "defines.h"
+
+/*
+ * A small assembler for the instructions the interpreter runs, with the
+ * usual CHIP-8 mnemonics (Cowgod's reference). One instruction per line,
+ * operands separated by commas, ';' starts a comment, case doesn't matter:
+ *
+ *   loop:   LD V0, 0x10         ; labels end with ':'
+ *           ADD V0, -1          ; bytes take -128 to 255
+ *           SE V0, 0
+ *           JP loop
+ *           LD I, sprite + 2    ; numbers are decimal, 0x/# hex or 0b/% binary,
+ *   sprite: DB 0xF0, 0x90       ; labels and numbers add and subtract
+ *           DW 0x1234           ; big endian words
+ *
+ *   CHIP-8     CLS, RET, JP addr, JP V0 addr, CALL addr, SE/SNE Vx byte|Vy,
+ *              LD Vx byte|Vy|DT|K|[I]|R, LD I|DT|ST|F|HF|B|[I]|R ..., ADD Vx byte|Vy,
+ *              ADD I Vx, OR/AND/XOR/SUB/SUBN Vx Vy, SHR/SHL Vx [Vy], RND Vx byte,
+ *              DRW Vx Vy n, SKP/SKNP Vx
+ *   SUPER-CHIP SCD n, SCR, SCL, LOW, HIGH, LD HF Vx, LD R Vx, LD Vx R
+ *   XO-CHIP    SAVE Vx Vy, LOAD Vx Vy, LD I LONG addr, PLANE n, AUDIO, PITCH Vx
+ *
+ * the program is assembled at PROGRAM_START, what the ROM loader expects
+ */
+
+// false with "line N: what's wrong" in error if the source doesn't assemble
+bool assemble(const std::string &source, std::vector<u8> &rom, std::string &error);
+
+#endif
\ No newline at end of file
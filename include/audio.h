@@ -0,0 +1,25 @@
+#ifndef _AUDIO_H
+#define _AUDIO_H
+
+#include "defines.h"
+
+// sound output, the emulation thread reports the sound timer once per frame
+// and the sink decides how to play it, setTimer() must never block. the SDL
+// device lives with the SDL frontend (frontends/sdl/sdl_audio.h)
+class Audio
+{
+public:
+    virtual ~Audio() {}
+    virtual void setTimer(u8) = 0;              // sound timer of the frame that just ran, the tone plays while it's non zero
+    virtual void setPattern(const u8 *, u8) = 0; // XO-CHIP pattern and pitch played instead of the buzzer
+};
+
+// discards the sound, used for headless runs or when no device is available
+class NullAudio : public Audio
+{
+public:
+    void setTimer(u8) override {}
+    void setPattern(const u8 *, u8) override {}
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include "defines.h"
+#include "frame.h"
+#include "expand.h"
+#include "spsc_queue.h"
+
+#define CAPTURE_QUEUE    64             // frames buffered between the emulation and the encoder, ~1s
+#define CAPTURE_POLL_MS  2              // encoder sleep while the queue is empty
+
+// output of a capture:
+//   Y4M: YUV4MPEG2 4:4:4 at TIMER_HZ, playable by ffmpeg/mpv
+//   RGB: headerless 24-bit RGB frames, ffmpeg -f rawvideo -pix_fmt rgb24
+//   RLE: only the rows that changed since the previous frame, see writeRLE()
+// Y4M and RGB are always 128x64 times the scale, lores frames are doubled
+enum class CaptureFormat
+{
+    Y4M,
+    RGB,
+    RLE,
+};
+
+// records finished frames to a file, submit() copies the frame into a
+// bounded queue and returns at once, a background thread does the encoding
+// and the disk I/O. frames that don't fit in the queue are dropped and counted.
+class Capture
+{
+public:
+    Capture();
+    bool open(const char *, CaptureFormat, int, const u32 palette[4]); // path, format, integer scale, colors
+    void submit(const Frame &);                 // emulation thread only, never blocks
+    void close();                               // encodes what is queued and closes the file
+    bool isOpen() const;
+    u64 written() const;                        // frames written to the file
+    u64 dropped() const;                        // frames lost because the queue was full
+    ~Capture();
+
+    Capture(const Capture &) = delete;
+    Capture &operator=(const Capture &) = delete;
+
+private:
+    void encode();                              // background thread loop
+    void write(const Frame &);
+    void writeImage(const Frame &);             // Y4M and RGB
+    void writeRLE(const Frame &);
+
+    SpscQueue<Frame, CAPTURE_QUEUE> queue;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<u64> frames_written;
+    std::atomic<u64> frames_dropped;
+
+    // owned by the encoder thread
+    FILE *file;
+    CaptureFormat format;
+    int scale;
+    u32 colors[4];                              // ARGB palette
+    u8 yuv[4][3];                               // the palette in Y, Cb, Cr for Y4M
+    u32 pixels[HIRES_WIDTH * HIRES_HEIGHT];     // composited frame, palette indices
+    u8 *row;                                    // one scaled output row
+    Frame previous;                             // last frame written as RLE
+    bool has_previous;
+};
+
+bool captureFormatFromName(const char *, CaptureFormat &); // "y4m", "rgb" or "rle"
+
+#endif
\ No newline at end of file
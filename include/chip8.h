@@ -1,97 +1,273 @@
-#ifndef _CHIP8_H
-#define _CHIP8_H
-
-#include "defines.h"
-
-class Chip8
-{
-public:
-    u8 keypad[KEYPAD_SIZE];                     // hexa keypad from [0:F]
-    u8 display[DISPLAY_WIDHT * DISPLAY_HEIGHT]; // the 64 * 32 screen
-
-    Chip8();
-    bool loadROM(char*);                        // load program instruction into the memory
-    void clock(bool&, bool&);                   // perform one clock cycle
-
-private:
-    // data members
-    u16 pc;                                     // program counter
-    u16 index;                                  // index register
-    u16 opcode;                                 // current instruction's opcode
-    u8 sp;                                      // stack pointer, points to current place can push in
-    u8 delay_timer;                             //
-    u8 sound_timer;                             //
-    u8 V[16];                                   // V registers from [0:F]
-    u8 memory[MEMORY_SIZE];                     // 4KB
-    u16 stack[STACK_SIZE];                      // 16 2-bytes-entrie
-
-    // member functions
-
-    void initFonts();                           // save fonts into the memory starting from 0x50:0x9F
-
-    // instruction decoding
-    u16 address();                              // gets address for opcodes on form ?NNN
-    u8 value();                                 // gets 8-bit value for opcodes of form ??NN
-    u8 regx();                                  // gets x for opcodes on form ?x??
-    u8 regy();                                  // gets y for opcodes on form ??y?
-
-    // register manipluating
-    u8 msb(u8);                                 // most significant bit
-    u8 lsb(u8);                                 // least significant bit 
-
-    // opcodes/ Instructions
-    void op_00E0();                             // clear display
-
-    void op_1NNN();                             // uncoditional jump to NNN
-
-    void op_2NNN();                             // jump to subrotine *(0xNNN)()
-    void op_00EE();                             // return;
-
-    void op_3XNN();                             // if (Vx == NN) pc+=2
-    void op_4XNN();                             // if (Vx != NN) pc+=2
-    void op_5XY0();                             // if (Vx == Vy) pc+=2
-    void op_9XY0();                             // if (Vx != Vy) pc+=2
-
-    void op_6XNN();                             // Vx = NNN
-    void op_7XNN();                             // Vx += NN
-
-    void op_8XY0();                             // Vx = Vy
-    void op_8XY1();                             // Vx = Vx | Vy
-    void op_8XY2();                             // Vx = Vx & Vy
-    void op_8XY3();                             // Vx = Vx ^ Vy
-    void op_8XY4();                             // Vx = Vx + Vy       :Vf=1 if there is overflow
-    void op_8XY5();                             // Vx = Vx - Vy       :Vf=0 if there is underflow
-    void op_8XY6();                             // Vx = Vx >> 1       :Vf=LSB before the shift
-    void op_8XY7();                             // Vx = Vy - Vx       :Vf=0 if there is underflow
-    void op_8XYE();                             // Vx = Vx << 1       :Vf=MSB before the shift
-
-    void op_ANNN();                             // I = NNN
-    void op_BNNN();                             // uncoditional jump to (V0 + NNN)
-    void op_CXNN();                             // Vx = rand() & NN
-    void op_DXYN();                             // bytes to draw are stored starting from I, 8xN rectangle
-
-    void op_EX9E();                             // if (key() == Vx) pc+=2
-    void op_EXA1();                             // if (key() != Vx) pc+=2
-    void op_FX0A();                             // Vx = get_key(), wait untill event happens
-
-    void op_FX07();                             // Vx = delay_timer
-    void op_FX15();                             // delay_timer = Vx
-    void op_FX18();                             // sound_timer = Vx
-
-    void op_FX1E();                             // I = I + Vx         :Vf=1 if there is overflow
-
-    void op_FX29();                             // I = sprite_addr[Vx]
-
-    void op_FX33();                             // if vx = 159: mem[i+0] = 1, mem[i+1] = 5, mem[i+2] = 9
-
-    void op_FX55();                             // mem[i]=v0, mem[i+1]=v1...mem[i+x]=vx. I: doesn't change
-    void op_FX65();                             // v0=mem[i], v1=mem[i+1]...vx=mem[i+x]. I: doesn't change
-
-    // instruction groups
-    void group_0(u8, std::string&);             // handling all instructions begin with 0
-    void group_8(u8, std::string&);             // handling all instructions begin with 8
-    void group_E(u8, std::string&);             // handling all instructions begin with E
-    void group_F(u8, std::string&);             // handling all instructions begin with F
-};
-
+#ifndef _CHIP8_H
+#define _CHIP8_H
+
+#include <cstddef>
+#include <memory>
+#include "defines.h"
+#include "frame.h"
+#include "variant.h"
+#include "quirks.h"
+#include "rng.h"
+
+#define STATE_MAGIC    0x54533843      // "C8ST"
+#define STATE_VERSION  2
+#define NO_BREAKPOINT  0x10000u        // past every address, pc never reaches it
+
+// leads every save state
+struct StateHeader
+{
+    u32 magic;                                  // STATE_MAGIC
+    u8 version;                                 // STATE_VERSION
+    u8 variant;                                 // Variant the state was saved from
+    u8 quirks;                                  // QuirkProfile the state was saved from
+    u8 reserved;
+    u32 size;                                   // whole state, header included
+};
+
+// what went wrong while running, sticky till clearFault()
+enum class Fault
+{
+    NONE,
+    MEMORY,                                     // an access ran past the end of memory and wrapped to 0
+    STACK,                                      // 2NNN on a full stack or 00EE on an empty one, sp wraps
+    ILLEGAL_OPCODE,                             // an unknown instruction, skipped
+};
+
+// why run()/runFrame() returned
+enum class StopReason
+{
+    BUDGET,                                     // run() executed all the instructions it was given
+    FRAME,                                      // the frame's instructions or VIP cycles ran, or DXYN waits for the vblank
+    DRAW,                                       // run() was asked to stop after a DXYN
+    WAITING,                                    // FX0A blocks till a key is pressed
+    BREAKPOINT,                                 // pc reached the breakpoint
+    STACK_FAULT,                                // the instruction that just ran raised Fault::STACK
+    ILLEGAL_OPCODE,                             // or Fault::ILLEGAL_OPCODE
+};
+
+struct RunResult
+{
+    StopReason reason;
+    u32 cycles;                                 // instructions executed
+    bool drew;                                  // a DXYN ran
+};
+
+// the CPU registers, for tools inspecting or comparing runs
+struct Registers
+{
+    u16 pc;
+    u16 index;
+    u16 opcode;                                 // last instruction executed
+    u8 sp;
+    u8 delay_timer;
+    u8 sound_timer;
+    u8 V[16];
+};
+
+// variant independent machine state and host interface,
+// the instructions are implemented by Chip8Core<Traits>
+class Chip8
+{
+public:
+    u8 keypad[KEYPAD_SIZE];                     // hexa keypad from [0:F]
+    Frame display;                              // the 64 * 32 screen, 128 * 64 in hires mode
+
+    virtual ~Chip8() {}
+    bool loadROM(const char*);                  // load a ROM file, mapped when possible (pipes are read), in rom_loader.cpp
+    bool loadROM(int);                          // load everything readable from a descriptor, stdin or a pipe, in rom_loader.cpp
+    bool loadROM(const u8*, size_t);            // load a ROM already in memory
+    virtual void clock(bool&) = 0;              // perform one clock cycle
+    virtual RunResult run(u32, bool stop_on_draw = false) = 0; // up to n instructions in one call, stops early on events
+    virtual RunResult runFrame(int, u32 limit = UINT32_MAX) = 0; // one TIMER_HZ frame of instructions (VIP cycles when timed)
+                                                // limit cuts it short after that many, to step through a frame
+    void setBreakpoint(u32);                    // run()/runFrame() stop when pc gets there, NO_BREAKPOINT clears it
+    virtual Variant variant() const = 0;
+    virtual QuirkProfile quirks() const = 0;
+    void updateTimers();                        // decrement delay/sound timers, called at TIMER_HZ
+    u8 soundTimer() const;                      // the buzzer sounds while it's non zero
+    bool isWaiting() const;                     // true while FX0A is blocked waiting for a key
+    const u8 *audioPattern() const;             // XO-CHIP pattern loaded by F002, nullptr for the plain buzzer
+    u8 audioPitch() const;                      // XO-CHIP pattern playback pitch set by FX3A
+    void seed(u64);                             // restarts CXNN's random sequence, saved with the state
+    virtual u8 peek(u32) const = 0;             // memory byte, the address wraps like the instructions' do
+    u8 reg(u8) const;                           // V register, for hosts reading scores or lives
+    Registers registers() const;
+    Fault fault() const;                        // the most serious fault seen
+    void clearFault();
+
+    // save states: the whole machine in one flat buffer of stateSize()
+    // bytes, loadable only into the same variant and quirk profile
+    virtual size_t stateSize() const = 0;
+    virtual void saveState(u8 *) const = 0;
+    virtual bool loadState(const u8 *, size_t) = 0; // false if the state doesn't belong to this core
+
+    // 64-bit hash of everything a state holds but the keypad, for telling
+    // states apart in searches. memory and display writes keep it up to date
+    // as they happen, the registers are hashed whole on each call
+    virtual u64 stateHash() = 0;
+    virtual u64 fullStateHash() const = 0;      // the same hash computed from scratch, to check the incremental one
+
+protected:
+    Chip8();
+
+    // data members
+    u16 pc;                                     // program counter
+    u16 index;                                  // index register
+    u16 opcode;                                 // current instruction's opcode
+    u8 sp;                                      // stack pointer, points to current place can push in
+    u8 delay_timer;                             //
+    u8 sound_timer;                             //
+    u8 V[16];                                   // V registers from [0:F]
+    u16 stack[STACK_SIZE];                      // 16 2-bytes-entrie
+    bool waiting;                               // FX0A in progress, no instructions are fetched
+    u8 wait_reg;                                // register FX0A stores the pressed key into
+    u8 flags[FLAGS_COUNT];                      // SUPER-CHIP RPL user flags
+    u8 plane;                                   // XO-CHIP bitmask of the planes being drawn, 1 otherwise
+    u8 pattern[PATTERN_SIZE];                   // XO-CHIP audio pattern buffer
+    u8 pitch;                                   // XO-CHIP audio pattern pitch
+    bool pattern_loaded;                        // F002 was executed at least once
+    bool vblank;                                // display_wait quirk: DXYN stalls till the next frame
+    Rng rng;                                    // CXNN random numbers, per instance
+    u8 faults;                                  // 1 << Fault of every fault seen, not part of the state
+    u8 trap;                                    // same for the instruction being run, run() stops on them
+    u32 breakpoint;                             // NO_BREAKPOINT if none
+    u64 memory_hash;                            // XOR of the key of every memory byte, see stateHash()
+    u64 display_hash;                           // XOR of the key of every display word
+    bool memory_stale;                          // memory_hash must be recomputed, after loading a ROM
+    bool display_stale;                         // display_hash must be recomputed, after clears and scrolls
+
+    // member functions
+
+    virtual u8 *program(size_t&) = 0;           // memory from PROGRAM_START and how many bytes fit there
+    void setResolution(u8, u8);                 // switch lores/hires, clears the display
+    bool resolveWait();                         // finish a pending FX0A if a key is pressed
+    size_t registersSize() const;               // bytes of everything but the memory in a state
+    void saveRegisters(u8 *&) const;            // writes everything but the memory, advances the pointer
+    void loadRegisters(const u8 *&);
+    u64 registersHash() const;
+    u64 displayHash() const;
+
+    // instruction decoding
+    u16 address();                              // gets address for opcodes on form ?NNN
+    u8 value();                                 // gets 8-bit value for opcodes of form ??NN
+    u8 regx();                                  // gets x for opcodes on form ?x??
+    u8 regy();                                  // gets y for opcodes on form ??y?
+
+    // register manipluating
+    u8 msb(u8);                                 // most significant bit
+    u8 lsb(u8);                                 // least significant bit 
+};
+
+// the interpreter for one variant and quirk profile, memory size, extension
+// opcodes and quirks are fixed at compile time (see variant.h and quirks.h)
+template <typename Traits, typename Quirks>
+class Chip8Core final : public Chip8
+{
+public:
+    Chip8Core();
+    void clock(bool&) override;
+    RunResult run(u32, bool stop_on_draw = false) override;
+    RunResult runFrame(int, u32 limit = UINT32_MAX) override;
+    u8 peek(u32) const override;
+    size_t stateSize() const override;
+    void saveState(u8 *) const override;
+    bool loadState(const u8 *, size_t) override;
+    u64 stateHash() override;
+    u64 fullStateHash() const override;
+    Variant variant() const override;
+    QuirkProfile quirks() const override;
+
+private:
+    u8 memory[Traits::memory_size];             // 4KB, 64KB on XO-CHIP
+    int budget;                                 // cycle timing: machine cycles left in the frame, negative once overrun
+
+    u8 *program(size_t&) override;
+    u8 &at(u32);                                // memory[address] wrapped to the address space, flags the wrap
+    void store(u32, u8);                        // at() = value, keeping memory_hash up to date
+    u64 memoryHash() const;
+    bool step(RunResult &, bool);               // one instruction for run()/runFrame(), false once they must stop
+    void execute(bool&);                        // fetch, decode and execute, clock() without the FX0A/vblank checks
+    void illegalOpcode();                       // raises Fault::ILLEGAL_OPCODE
+    void initFonts();                           // save fonts into the memory starting from 0x50:0x103
+    u32 vipCycles() const;                      // cycle timing: VIP machine cycles of the current opcode
+    void skipNext();                            // skips the next instruction, F000 NNNN is 4 bytes on XO-CHIP
+
+    // opcodes/ Instructions
+    void op_00E0();                             // clear display
+
+    void op_00CN();                             // scroll display N rows down
+    void op_00FB();                             // scroll display 4 pixels right
+    void op_00FC();                             // scroll display 4 pixels left
+    void op_00FE();                             // lores 64x32 mode
+    void op_00FF();                             // hires 128x64 mode
+
+    void op_1NNN();                             // uncoditional jump to NNN
+
+    void op_2NNN();                             // jump to subrotine *(0xNNN)()
+    void op_00EE();                             // return;
+
+    void op_3XNN();                             // if (Vx == NN) pc+=2
+    void op_4XNN();                             // if (Vx != NN) pc+=2
+    void op_5XY0();                             // if (Vx == Vy) pc+=2
+    void op_5XY2();                             // mem[i]=vx...mem[i+|x-y|]=vy. I: doesn't change
+    void op_5XY3();                             // vx=mem[i]...vy=mem[i+|x-y|]. I: doesn't change
+    void op_9XY0();                             // if (Vx != Vy) pc+=2
+
+    void op_6XNN();                             // Vx = NNN
+    void op_7XNN();                             // Vx += NN
+
+    void op_8XY0();                             // Vx = Vy
+    void op_8XY1();                             // Vx = Vx | Vy
+    void op_8XY2();                             // Vx = Vx & Vy
+    void op_8XY3();                             // Vx = Vx ^ Vy
+    void op_8XY4();                             // Vx = Vx + Vy       :Vf=1 if there is overflow
+    void op_8XY5();                             // Vx = Vx - Vy       :Vf=0 if there is underflow
+    void op_8XY6();                             // Vx = Vx >> 1       :Vf=LSB before the shift
+    void op_8XY7();                             // Vx = Vy - Vx       :Vf=0 if there is underflow
+    void op_8XYE();                             // Vx = Vx << 1       :Vf=MSB before the shift
+
+    void op_ANNN();                             // I = NNN
+    void op_F000();                             // I = NNNN, the next 16-bit word
+    void op_BNNN();                             // uncoditional jump to (V0 + NNN), (VX + XNN) with jump_vx
+    void op_CXNN();                             // Vx = rand() & NN
+    void op_DXYN();                             // bytes to draw are stored starting from I, 8xN rectangle, DXY0: 16x16
+
+    void op_EX9E();                             // if (key() == Vx) pc+=2
+    void op_EXA1();                             // if (key() != Vx) pc+=2
+    void op_FX0A();                             // Vx = get_key(), wait untill event happens
+
+    void op_FX07();                             // Vx = delay_timer
+    void op_FX15();                             // delay_timer = Vx
+    void op_FX18();                             // sound_timer = Vx
+
+    void op_FX1E();                             // I = I + Vx         :Vf=1 if there is overflow
+
+    void op_FX29();                             // I = sprite_addr[Vx]
+    void op_FX30();                             // I = big_sprite_addr[Vx]
+
+    void op_FX33();                             // if vx = 159: mem[i+0] = 1, mem[i+1] = 5, mem[i+2] = 9
+
+    void op_FX55();                             // mem[i]=v0, mem[i+1]=v1...mem[i+x]=vx. I: doesn't change
+    void op_FX65();                             // v0=mem[i], v1=mem[i+1]...vx=mem[i+x]. I: doesn't change
+
+    void op_FX75();                             // flags[0]=v0...flags[x]=vx
+    void op_FX85();                             // v0=flags[0]...vx=flags[x]
+
+    void op_FN01();                             // plane = N
+    void op_F002();                             // pattern = mem[i:i+15]
+    void op_FX3A();                             // pitch = Vx
+
+    // instruction groups
+    void group_0(u8, const char*&);             // handling all instructions begin with 0
+    void group_5(u8, const char*&);             // handling all instructions begin with 5
+    void group_8(u8, const char*&);             // handling all instructions begin with 8
+    void group_E(u8, const char*&);             // handling all instructions begin with E
+    void group_F(u8, const char*&);             // handling all instructions begin with F
+};
+
+// builds the interpreter matching the variant and quirk profile
+std::unique_ptr<Chip8> createChip8(Variant, QuirkProfile);
+std::unique_ptr<Chip8> createChip8(Variant);    // with the variant's usual quirks
+QuirkProfile defaultQuirks(Variant);
+
 #endif
\ No newline at end of file
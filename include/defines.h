@@ -1,76 +1,89 @@
-#ifndef _DEFINES_H
-#define _DEFINES_H
-
-#include <cinttypes>
-#include <iostream>
-#include "../3rdparty/inc/SDL.h"
-
-// Defines
-#define u8             uint8_t
-#define i8             int8_t
-#define u16            uint16_t
-#define u32            uint32_t
-#define MEMORY_SIZE    4096
-#define STACK_SIZE     16
-#define KEYPAD_SIZE    16
-#define DISPLAY_WIDHT  64
-#define DISPLAY_HEIGHT 32
-#define FONTS_COUNT    80              // takes 5-bytes by each charcater 5*16 = 80
-#define FONTS_START    0x50            // [0x50:0x9F] 0x50+80=0x9F
-#define PROGRAM_START  0x200           // Start of most Chip-8 programs
-#define DELAY_TIME     700
-#define QUIRK          1
-
-#define DEBUG 1
-#define NO_OPCODE "XXXX"
-#define debug_print(format, ...)                  \
-    do                                         \
-    {                                          \
-        if (DEBUG)                             \
-            fprintf(stderr, format, __VA_ARGS__); \
-    } while (0)
-
-// Global Data
-inline const u8 font_sprite[FONTS_COUNT] =
-{
-    0xF0, 0x90, 0x90, 0x90, 0xF0,      // 0
-    0x20, 0x60, 0x20, 0x20, 0x70,      // 1
-    0xF0, 0x10, 0xF0, 0x80, 0xF0,      // 2
-    0xF0, 0x10, 0xF0, 0x10, 0xF0,      // 3
-    0x90, 0x90, 0xF0, 0x10, 0x10,      // 4
-    0xF0, 0x80, 0xF0, 0x10, 0xF0,      // 5
-    0xF0, 0x80, 0xF0, 0x90, 0xF0,      // 6
-    0xF0, 0x10, 0x20, 0x40, 0x40,      // 7
-    0xF0, 0x90, 0xF0, 0x90, 0xF0,      // 8
-    0xF0, 0x90, 0xF0, 0x10, 0xF0,      // 9
-    0xF0, 0x90, 0xF0, 0x90, 0x90,      // A
-    0xE0, 0x90, 0xE0, 0x90, 0xE0,      // B
-    0xF0, 0x80, 0x80, 0x80, 0xF0,      // C
-    0xE0, 0x90, 0x90, 0x90, 0xE0,      // D
-    0xF0, 0x80, 0xF0, 0x80, 0xF0,      // E
-    0xF0, 0x80, 0xF0, 0x80, 0x80       // F
-};
-
-
-/*
- * Keypad       Keyboard
- * +-+-+-+-+    +-+-+-+-+
- * |1|2|3|C|    |1|2|3|4|
- * +-+-+-+-+    +-+-+-+-+
- * |4|5|6|D|    |Q|W|E|R|
- * +-+-+-+-+ => +-+-+-+-+
- * |7|8|9|E|    |A|S|D|F|
- * +-+-+-+-+    +-+-+-+-+
- * |A|0|B|F|    |Z|X|C|V|
- * +-+-+-+-+    +-+-+-+-+
-*/
-inline const SDL_Scancode keypad_to_keyboard[KEYPAD_SIZE] = 
-{
-    SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
-    SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
-    SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
-    SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
-};
-
-
+#ifndef _DEFINES_H
+#define _DEFINES_H
+
+#include <cinttypes>
+#include <cstdio>
+
+// Defines
+#define u8             uint8_t
+#define i8             int8_t
+#define i16            int16_t
+#define u16            uint16_t
+#define u32            uint32_t
+#define u64            uint64_t
+#define MEMORY_SIZE    4096
+#define XO_MEMORY_SIZE 65536           // XO-CHIP 64KB address space
+#define STACK_SIZE     16
+#define KEYPAD_SIZE    16
+#define DISPLAY_WIDHT  64
+#define DISPLAY_HEIGHT 32
+#define HIRES_WIDTH    128             // SUPER-CHIP high resolution mode
+#define HIRES_HEIGHT   64
+#define ROW_WORDS      2               // 64-bit words per packed display row
+#define FLAGS_COUNT    16              // RPL user flags saved by FX75, 16 on every variant (SUPER-CHIP had 8, its ROMs stay below)
+#define PLANES_COUNT   2               // XO-CHIP display bitplanes
+#define PATTERN_SIZE   16              // XO-CHIP audio pattern buffer, 128 1-bit samples
+#define PATTERN_PITCH  64              // default pitch, plays the pattern at 4000 bits per second
+#define FONTS_COUNT    80              // takes 5-bytes by each charcater 5*16 = 80
+#define FONTS_START    0x50            // [0x50:0x9F] 0x50+80=0x9F
+#define BIG_FONTS_COUNT 100            // SUPER-CHIP 8x10 digits, 10-bytes by each digit
+#define BIG_FONTS_START 0xA0           // [0xA0:0x103]
+#define PROGRAM_START  0x200           // Start of most Chip-8 programs
+#define DELAY_TIME     700             // instructions executed per second
+#define TIMER_HZ       60              // delay/sound timers rate, also the frame rate
+#define CYCLES_PER_FRAME (DELAY_TIME / TIMER_HZ)
+#define VIP_FRAME_CYCLES 2572          // VIP machine cycles per frame left to CHIP-8, 3668 minus display DMA and interrupt
+
+#ifndef DEBUG
+#define DEBUG 1                        // -DDEBUG=0 silences the per instruction trace
+#endif
+#define NO_OPCODE "XXXX"
+#ifdef _MSC_VER
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
+#define debug_print(format, ...)                  \
+    do                                         \
+    {                                          \
+        if (DEBUG)                             \
+            fprintf(stderr, format, __VA_ARGS__); \
+    } while (0)
+
+// Global Data
+inline const u8 font_sprite[FONTS_COUNT] =
+{
+    0xF0, 0x90, 0x90, 0x90, 0xF0,      // 0
+    0x20, 0x60, 0x20, 0x20, 0x70,      // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0,      // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0,      // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10,      // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0,      // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0,      // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40,      // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0,      // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0,      // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90,      // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0,      // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0,      // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0,      // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0,      // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80       // F
+};
+
+// SUPER-CHIP large font, only the decimal digits exist
+inline const u8 big_font_sprite[BIG_FONTS_COUNT] =
+{
+    0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+    0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+    0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+    0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+    0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+    0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C  // 9
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef _EXPAND_H
+#define _EXPAND_H
+
+#include "defines.h"
+#include "frame.h"
+
+#define MAX_SCALE 16                            // largest integer upscale
+
+// display to host pixels: every pixel's 2-bit palette index becomes a 32-bit
+// palette color, repeated scale times in both directions. the palette is
+// taken as is, so it decides the byte order (ARGB8888 for SDL textures,
+// RGBA8888, ...). rows are pitch pixels apart in the output.
+enum class ExpandKernel
+{
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+// packed bitplanes of a Frame, out is width * scale by height * scale
+void expandFrame(const Frame &, const u32 palette[4], int scale, u32 *out, int pitch);
+
+// byte per pixel palette indices (0-3), width must be a multiple of 8
+void expandIndices(const u8 *, int width, int height, const u32 palette[4], int scale, u32 *out, int pitch);
+
+ExpandKernel expandKernel();                    // kernel in use, the best one the cpu supports by default
+bool setExpandKernel(ExpandKernel);             // false if the cpu lacks it, used by the benchmark
+const char *expandKernelName(ExpandKernel);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include "defines.h"
+
+// packed 1-bit bitplanes, every row is 128 pixels stored in two 64-bit
+// words with the left most pixel in the msb of planes[p][y][0]. lores 64x32
+// only uses the first word of the first 32 rows, so scrolling and drawing are
+// shifts and xors on whole words in both resolutions. CHIP-8 and SUPER-CHIP
+// only draw to plane 0, XO-CHIP draws to both and a pixel's color is the
+// 2-bit index (plane 1 bit, plane 0 bit) into a 4 colors palette.
+struct Frame
+{
+    u64 planes[PLANES_COUNT][HIRES_HEIGHT][ROW_WORDS];
+    u8 width;                                   // DISPLAY_WIDHT or HIRES_WIDTH
+    u8 height;                                  // DISPLAY_HEIGHT or HIRES_HEIGHT
+
+    u8 pixel(int x, int y) const                // palette index of pixel (x, y), 0 is off
+    {
+        int shift = 63 - (x & 63);
+        return (u8)(((planes[0][y][x >> 6] >> shift) & 1u) | (((planes[1][y][x >> 6] >> shift) & 1u) << 1));
+    }
+};
+
+#endif
\ No newline at end of file
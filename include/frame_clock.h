@@ -0,0 +1,51 @@
+#ifndef _FRAME_CLOCK_H
+#define _FRAME_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include "defines.h"
+
+#define JITTER_BUCKETS  18              // <1us, <2us, <4us ... <65ms, more
+
+// frame pacing counters, bucket i counts wake ups that were late by
+// [2^(i-1), 2^i) microseconds, bucket 0 the ones late by less than 1us
+struct JitterStats
+{
+    u64 frames;                                 // frames waited for
+    u64 overruns;                               // deadlines already gone when the frame's work ended
+    u64 max_us;                                 // latest wake up seen
+    u64 buckets[JITTER_BUCKETS];
+};
+
+// paces a loop at a fixed rate against absolute deadlines, so a late frame
+// doesn't push the following ones back. on Linux it sleeps on a timerfd,
+// elsewhere on steady_clock, and can spin the last spin_us microseconds
+// before each deadline for sub 100us accuracy. missed deadlines are skipped
+// rather than caught up with a burst of frames.
+class FrameClock
+{
+public:
+    FrameClock(u32 hz, u32 spin_us = 0);
+    void start();                               // the first deadline is one period from now
+    bool wait();                                // sleeps till the next deadline and records the jitter, false on overrun
+    JitterStats stats() const;                  // safe to call from any thread while running
+    ~FrameClock();
+
+    FrameClock(const FrameClock &) = delete;
+    FrameClock &operator=(const FrameClock &) = delete;
+
+private:
+    void record(u64 late_us, u64 missed);
+
+    std::chrono::nanoseconds period;
+    std::chrono::nanoseconds spin;
+    std::chrono::steady_clock::time_point deadline;
+    int timer;                                  // timerfd, -1 where it isn't available
+
+    std::atomic<u64> frames;
+    std::atomic<u64> overruns;
+    std::atomic<u64> max_us;
+    std::atomic<u64> buckets[JITTER_BUCKETS];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+#include "defines.h"
+
+// read-only memory mapping of a whole file, the pages are loaded lazily
+// by the OS so opening is constant time whatever the file size
+class MappedFile
+{
+public:
+    MappedFile();
+    bool open(const char *);                    // maps the file, false if it can't be opened
+    void close();
+    const u8 *data() const;
+    size_t size() const;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+    const u8 *mapping;
+    size_t length;
+#ifdef _WIN32
+    void *file;                                 // HANDLE of the file
+    void *view;                                 // HANDLE of the file mapping
+#endif
+};
+
+#endif
\ No newline at end of file
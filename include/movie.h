@@ -0,0 +1,127 @@
+#ifndef _MOVIE_H
+#define _MOVIE_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "defines.h"
+#include "variant.h"
+#include "quirks.h"
+#include "sha1.h"
+#include "mapped_file.h"
+
+#define MOVIE_MAGIC           0x564D3843    // "C8MV", also rejects files written with the other endianness
+#define MOVIE_VERSION         1
+#define MOVIE_KEYFRAME_EVERY  300           // frames between two keyframes, 5 emulated seconds
+
+class Chip8;
+
+/*
+ * Input movies: the keypad bitmask of every frame of a session, with a save
+ * state (keyframe) every keyframe_every frames so any frame can be reached
+ * without replaying the whole movie. After the header the file is a run of
+ * equally sized chunks, each one a keyframe followed by the keys of the
+ * keyframe_every frames it starts:
+ *
+ *   header | state 0 | keys 0 ... N-1 | state N | keys N ... 2N-1 | ...
+ *
+ * so the index is the chunk stride, and recording only ever appends. The
+ * last chunk may be partial, a keyframe that was cut short is ignored.
+ */
+
+// recorded frames, read from a mapping of the file
+class Movie
+{
+public:
+    Movie();
+    bool open(const char *);                    // maps a movie, false if the file isn't one
+    void close();
+
+    u64 frames() const;                         // frames with recorded keys
+    u16 keys(u64) const;                        // keypad bitmask of a frame, none past the end
+    Variant variant() const;                    // machine the movie was recorded on
+    QuirkProfile quirks() const;
+    u32 cyclesPerFrame() const;
+    u64 seed() const;
+    const u8 *digest() const;                   // SHA-1 of the ROM
+
+    // chip8 is left as it was before the frame ran, frames() is the end of
+    // the movie. loads the closest keyframe and replays at most
+    // keyframe_every frames, false if chip8 isn't of the movie's variant and
+    // quirk profile or the frame is past the end
+    bool seek(Chip8 &, u64) const;
+
+    // one frame as recorded: keys, the instructions and the timers
+    static void step(Chip8 &, u16 keys, u32 cycles_per_frame);
+
+private:
+    struct Header
+    {
+        u32 magic;
+        u32 version;
+        u8 digest[SHA1_SIZE];
+        u32 state_size;                         // bytes of each keyframe
+        u64 seed;                               // CXNN seed the recording started with
+        u32 cycles_per_frame;
+        u32 keyframe_every;
+    };
+
+    // the file is mapped as is, the layout must not depend on the compiler
+    static_assert(sizeof(Header) == 48, "unexpected Movie::Header padding");
+
+    size_t chunkSize() const;
+    const u8 *keyframe(u64) const;
+
+    MappedFile file;
+    const Header *header;
+    u64 frame_count;
+    u64 keyframes;                              // complete keyframes
+
+    friend class MovieWriter;
+};
+
+// records a movie frame by frame. record() only copies the keys and the
+// keyframes into memory, every complete chunk is handed to a background
+// thread that writes and flushes it, so recording never waits on the disk
+// and a crash loses one chunk at most
+class MovieWriter
+{
+public:
+    MovieWriter();
+
+    // continues the movie in the file from its last frame, chip8 is seeked
+    // there, or starts a new one from chip8's state if there is no file.
+    // false if the file holds something else, it is never overwritten
+    bool open(const char *, Chip8 &, const u8 digest[SHA1_SIZE], u32 cycles_per_frame, u64 seed,
+              u32 keyframe_every = MOVIE_KEYFRAME_EVERY);
+    void record(const Chip8 &, u16 keys);       // call before running each frame with the keys it runs with
+    u64 frames() const;                         // frames recorded, the ones before open() included
+    bool isOpen() const;
+    void close();                               // writes what was recorded and closes the file
+    ~MovieWriter();
+
+    MovieWriter(const MovieWriter &) = delete;
+    MovieWriter &operator=(const MovieWriter &) = delete;
+
+private:
+    void stageKeyframe(const Chip8 &);
+    void handOff();                             // staged bytes to the writer thread
+    void writeLoop();                           // background thread loop
+
+    FILE *out;                                  // written by the writer thread once it runs
+    bool opened;
+    std::vector<u8> staged;                     // recorded, not handed off yet
+    u64 frame_count;
+    u32 keyframe_every;
+    bool keyframed;                             // the keyframe of the current chunk is staged or written
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;               // bytes were handed off or the writer stops
+    std::vector<u8> pending;                    // handed off, not written yet
+    bool stop;
+};
+
+#endif
\ No newline at end of file
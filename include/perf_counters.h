@@ -0,0 +1,47 @@
+#ifndef _PERF_COUNTERS_H
+#define _PERF_COUNTERS_H
+
+#include "defines.h"
+
+// hardware events counted around a piece of code
+enum class PerfCounter
+{
+    INSTRUCTIONS,                               // host instructions retired
+    CYCLES,
+    BRANCH_MISSES,
+    L1D_MISSES,                                 // L1 data cache read misses
+    LLC_MISSES,                                 // last level cache misses
+    COUNT
+};
+
+// the calling thread's counters through perf_event_open, user space only.
+// each counter is opened on its own so the ones the cpu or the kernel
+// refuses (containers, VMs without a PMU, perf_event_paranoid) are just
+// missing. there are none outside of Linux. counts are scaled up when the
+// kernel had to multiplex the counters
+class PerfCounters
+{
+public:
+    PerfCounters();
+    bool available(PerfCounter) const;
+    bool any() const;                           // at least one counter opened
+    const char *error() const;                  // why the first counter that failed did, nullptr if none did
+    void start();                               // resets and enables the counters
+    void stop();                                // disables them and reads the counts
+    u64 value(PerfCounter) const;               // count between the last start() and stop()
+    ~PerfCounters();
+
+    static const char *name(PerfCounter);
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+private:
+    int fds[(int)PerfCounter::COUNT];           // -1 when unavailable
+    u64 values[(int)PerfCounter::COUNT];
+    u64 enabled[(int)PerfCounter::COUNT];       // times at start(), a reset doesn't clear them
+    u64 running[(int)PerfCounter::COUNT];
+    int failure;                                // errno of the first counter that failed to open, 0 if none
+};
+
+#endif
\ No newline at end of file
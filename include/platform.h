@@ -1,20 +1,55 @@
-#ifndef _PLATFORM_H
-#define _PLATFORM_H
-
-#include "defines.h"
-#include "../3rdparty/inc/SDL.h"
-
-class Platform
-{
-public:
-    Platform();
-    bool inputHandler(u8 *);                 // handling keypad status, takes Chip8 keypad as an parmater
-    void updateScreen(u8 *);
-    ~Platform();
-
-private:
-    SDL_Window *window;
-    SDL_Renderer *renderer;
-};
-
+#ifndef _PLATFORM_H
+#define _PLATFORM_H
+
+#include "defines.h"
+#include "frame.h"
+#include "expand.h"
+#include "../3rdparty/inc/SDL.h"
+
+#define WINDOW_WIDTH   (DISPLAY_WIDHT * 8)
+#define WINDOW_HEIGHT  (DISPLAY_HEIGHT * 8)
+
+/*
+ * Keypad       Keyboard
+ * +-+-+-+-+    +-+-+-+-+
+ * |1|2|3|C|    |1|2|3|4|
+ * +-+-+-+-+    +-+-+-+-+
+ * |4|5|6|D|    |Q|W|E|R|
+ * +-+-+-+-+ => +-+-+-+-+
+ * |7|8|9|E|    |A|S|D|F|
+ * +-+-+-+-+    +-+-+-+-+
+ * |A|0|B|F|    |Z|X|C|V|
+ * +-+-+-+-+    +-+-+-+-+
+*/
+inline const SDL_Scancode keypad_to_keyboard[KEYPAD_SIZE] =
+{
+    SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+    SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+    SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+    SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+};
+
+// background, plane 0, plane 1, both planes (ARGB8888)
+inline const u32 palette[4] = {0xFF000000, 0xFF00FF00, 0xFF008000, 0xFFB0FFB0};
+
+class Platform
+{
+public:
+    Platform();
+    bool inputHandler(u8 *);                 // handling keypad status, takes Chip8 keypad as an parmater
+    bool waitInput(u8 *, u32);               // like inputHandler() but blocks for an event up to timeout ms
+    void updateScreen(const Frame &);           // draws lores or hires frames scaled to the window
+    bool turboToggled();                     // Tab was pressed since the last call
+    ~Platform();
+
+private:
+    bool handleEvent(const SDL_Event &, u8 *);
+
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;                    // HIRES_WIDTH * HIRES_HEIGHT, lores uses its top left corner
+    u32 pixels[HIRES_WIDTH * HIRES_HEIGHT];  // composited frame uploaded to the texture
+    bool turbo_toggled;                      // a Tab press not yet reported
+};
+
 #endif
\ No newline at end of file
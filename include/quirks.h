@@ -0,0 +1,78 @@
+#ifndef _QUIRKS_H
+#define _QUIRKS_H
+
+// quirk profiles, selected at runtime by createChip8()
+enum class QuirkProfile
+{
+    DEFAULT,                                    // what this emulator always did
+    VIP,                                        // original COSMAC VIP interpreter
+    SCHIP,                                      // SUPER-CHIP 1.1
+    XOCHIP,                                     // Octo / XO-CHIP
+    VIP_TIMED                                   // COSMAC VIP quirks and instruction timing
+};
+
+// every profile is a compile time constant set, Chip8Core<Traits, Quirks>
+// resolves each quirk with if constexpr so unused branches cost nothing
+struct DefaultQuirks
+{
+    static constexpr QuirkProfile profile = QuirkProfile::DEFAULT;
+    static constexpr bool vf_reset = false;             // 8XY1/8XY2/8XY3 set VF = 0
+    static constexpr bool memory_increment = true;      // FX55/FX65 leave I = I + X + 1
+    static constexpr bool shift_vy = true;              // 8XY6/8XYE shift Vy into Vx instead of Vx
+    static constexpr bool jump_vx = false;              // BNNN jumps to XNN + VX instead of NNN + V0
+    static constexpr bool clipping = true;              // sprites are clipped at the edges instead of wrapping
+    static constexpr bool display_wait = false;         // DXYN waits for the next frame (vertical blank)
+    static constexpr bool cycle_timing = false;         // frames last VIP machine cycles instead of instructions
+};
+
+struct VipQuirks
+{
+    static constexpr QuirkProfile profile = QuirkProfile::VIP;
+    static constexpr bool vf_reset = true;
+    static constexpr bool memory_increment = true;
+    static constexpr bool shift_vy = true;
+    static constexpr bool jump_vx = false;
+    static constexpr bool clipping = true;
+    static constexpr bool display_wait = true;
+    static constexpr bool cycle_timing = false;
+};
+
+struct SChipQuirks
+{
+    static constexpr QuirkProfile profile = QuirkProfile::SCHIP;
+    static constexpr bool vf_reset = false;
+    static constexpr bool memory_increment = false;
+    static constexpr bool shift_vy = false;
+    static constexpr bool jump_vx = true;
+    static constexpr bool clipping = true;
+    static constexpr bool display_wait = false;
+    static constexpr bool cycle_timing = false;
+};
+
+struct XOChipQuirks
+{
+    static constexpr QuirkProfile profile = QuirkProfile::XOCHIP;
+    static constexpr bool vf_reset = false;
+    static constexpr bool memory_increment = true;
+    static constexpr bool shift_vy = true;
+    static constexpr bool jump_vx = false;
+    static constexpr bool clipping = false;
+    static constexpr bool display_wait = false;
+    static constexpr bool cycle_timing = false;
+};
+
+// the VIP quirks with every instruction charged what it took the VIP
+// interpreter, for accuracy testing
+struct VipTimedQuirks
+{
+    static constexpr QuirkProfile profile = QuirkProfile::VIP_TIMED;
+    static constexpr bool vf_reset = true;
+    static constexpr bool memory_increment = true;
+    static constexpr bool shift_vy = true;
+    static constexpr bool jump_vx = false;
+    static constexpr bool clipping = true;
+    static constexpr bool display_wait = true;
+    static constexpr bool cycle_timing = true;
+};
+
+#endif
\ No newline at end of file
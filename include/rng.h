@@ -0,0 +1,55 @@
+#ifndef _RNG_H
+#define _RNG_H
+
+#include "defines.h"
+
+#define RNG_DEFAULT_SEED 0x43484950382B2B00ull // "CHIP8++", runs are reproducible unless reseeded
+
+// xoshiro128** with a splitmix64 seeded state, 16 bytes per instance and a
+// handful of shifts per number, no global state so every Chip8 owns one
+struct Rng
+{
+    u32 s[4];
+
+    void seed(u64 value)
+    {
+        for (int i = 0; i < 4; i += 2)
+        {
+            // splitmix64, spreads any seed (even 0) over the whole state
+            value += 0x9E3779B97F4A7C15ull;
+            u64 z = value;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            s[i] = (u32)z;
+            s[i + 1] = (u32)(z >> 32);
+        }
+    }
+
+    u32 next()
+    {
+        u32 result = rotl(s[1] * 5, 7) * 9;
+        u32 t = s[1] << 9;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return result;
+    }
+
+    u8 byte()                                   // the high bits are the best ones
+    {
+        return (u8)(next() >> 24);
+    }
+
+private:
+    static u32 rotl(u32 x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+};
+
+#endif
\ No newline at end of file
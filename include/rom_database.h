@@ -0,0 +1,80 @@
+#ifndef _ROM_DATABASE_H
+#define _ROM_DATABASE_H
+
+#include <vector>
+#include "defines.h"
+#include "variant.h"
+#include "quirks.h"
+#include "sha1.h"
+#include "mapped_file.h"
+
+#define ROMDB_MAGIC    0x42443843      // "C8DB", also rejects files built with the other endianness
+#define ROMDB_VERSION  1
+
+// how to run one ROM
+struct RomInfo
+{
+    Variant variant;
+    QuirkProfile quirks;
+    u16 cycles_per_frame;                       // instructions executed per 1/TIMER_HZ frame
+    u8 keymap[KEYPAD_SIZE];                     // keymap[i]: chip-8 key driven by the host key of keypad i
+};
+
+struct RomEntry
+{
+    u8 digest[SHA1_SIZE];                       // SHA-1 of the ROM file
+    RomInfo info;
+};
+
+// ROM settings keyed by content hash. the index is an open addressing hash
+// table written by build() and memory mapped by open(), so startup doesn't
+// parse anything and a lookup reads one or two records.
+class RomDatabase
+{
+public:
+    RomDatabase();
+    bool open(const char *);                    // maps an index built by build()
+    bool lookup(const u8 digest[SHA1_SIZE], RomInfo &) const; // false if unknown or the record is invalid
+    u32 size() const;                           // number of ROMs in the index
+
+    static bool build(const char *, const std::vector<RomEntry> &);
+
+private:
+    struct Header
+    {
+        u32 magic;
+        u32 version;
+        u32 buckets;                            // power of two
+        u32 count;
+    };
+
+    struct Record
+    {
+        u8 digest[SHA1_SIZE];
+        u8 used;
+        u8 variant;
+        u8 quirks;
+        u8 reserved;
+        u16 cycles_per_frame;
+        u16 reserved2;
+        u8 keymap[KEYPAD_SIZE];
+    };
+
+    // the index is mapped as is, the layout must not depend on the compiler
+    static_assert(sizeof(Record) == 44, "unexpected RomDatabase::Record padding");
+
+    static u32 bucketOf(const u8 digest[SHA1_SIZE], u32);
+
+    MappedFile file;
+    const Header *header;
+    const Record *records;
+};
+
+// settings used when a ROM isn't in the index
+RomInfo defaultRomInfo(Variant);
+
+// names used by the command line and the index source files
+bool variantFromName(const char *, Variant &);
+bool quirksFromName(const char *, QuirkProfile &);
+
+#endif
\ No newline at end of file
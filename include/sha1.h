@@ -0,0 +1,12 @@
+#ifndef _SHA1_H
+#define _SHA1_H
+
+#include <cstddef>
+#include "defines.h"
+
+#define SHA1_SIZE      20              // digest bytes
+
+// SHA-1 of a whole buffer, used to identify ROMs by content
+void sha1(const u8 *, size_t, u8 digest[SHA1_SIZE]);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "defines.h"
+#include "sha1.h"
+#include "mapped_file.h"
+
+#define SNAPSHOT_MAGIC    0x53513843    // "C8QS", also rejects files written with the other endianness
+#define SNAPSHOT_VERSION  1
+
+class Chip8;
+
+// where and how a snapshot was taken, a cached snapshot only stands in for
+// a run with the same settings
+struct SnapshotInfo
+{
+    u64 frame;                                  // emulated frames run before it was taken
+    u64 seed;                                   // CXNN seed the run started from
+    u32 cycles_per_frame;                       // instructions per frame the run used
+};
+
+// a save state on disk tagged with the SHA-1 of its ROM, for resuming a
+// session or skipping a ROM's boot frames. open() maps the file and
+// restore() loads the state straight from the mapping, nothing is parsed
+class Snapshot
+{
+public:
+    Snapshot();
+    bool open(const char *, const u8 digest[SHA1_SIZE]); // maps a snapshot of that ROM, false if there is none
+    bool restore(Chip8 &) const;                // false if it belongs to another variant or quirk profile
+    SnapshotInfo info() const;
+    void close();
+
+    // writes a new file then renames it over the old one, a crash never
+    // leaves half a snapshot behind. the directory is created if needed
+    static bool write(const char *, const Chip8 &, const u8 digest[SHA1_SIZE], const SnapshotInfo &);
+    static bool write(const char *, const u8 *state, size_t, const u8 digest[SHA1_SIZE], const SnapshotInfo &);
+
+    // <directory>/<ROM SHA-1 in hex>.<extension>
+    static std::string path(const char *directory, const u8 digest[SHA1_SIZE], const char *extension);
+
+private:
+    struct Header
+    {
+        u32 magic;
+        u32 version;
+        u8 digest[SHA1_SIZE];
+        u32 size;                               // save state bytes following the header
+        u64 frame;                              // SnapshotInfo, field by field so there is no padding
+        u64 seed;
+        u32 cycles_per_frame;
+        u32 reserved;
+    };
+
+    // the file is mapped as is, the layout must not depend on the compiler
+    static_assert(sizeof(Header) == 56, "unexpected Snapshot::Header padding");
+
+    MappedFile file;
+    const Header *header;
+};
+
+// periodic snapshots from the emulation thread: submit() copies the state
+// into a one-slot mailbox and returns, a background thread does the disk
+// I/O. a snapshot still waiting when the next one comes is replaced by it
+class SnapshotWriter
+{
+public:
+    SnapshotWriter();
+    void submit(const std::string &, const Chip8 &, const u8 digest[SHA1_SIZE], const SnapshotInfo &);
+    void flush();                               // waits till the submitted snapshot is written
+    u64 failures() const;                       // snapshots that couldn't be written
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+private:
+    // a snapshot to write, swapped between the submitter and the writer so
+    // the state buffers are allocated once
+    struct Job
+    {
+        std::string path;
+        std::vector<u8> state;
+        u8 digest[SHA1_SIZE];
+        SnapshotInfo info;
+    };
+
+    void writeLoop();                           // background thread loop
+
+    std::thread worker;                         // started by the first submit()
+    mutable std::mutex mutex;
+    std::condition_variable wake;               // a snapshot was submitted or the writer stops
+    std::condition_variable idle;               // the mailbox is empty and nothing is being written
+    Job mailbox;                                // submitted, not picked up yet
+    Job spare;                                  // the submitter's buffers
+    bool full;
+    bool writing;
+    bool stop;
+    u64 failed;
+};
+
+#endif
\ No newline at end of file
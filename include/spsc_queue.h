@@ -0,0 +1,43 @@
+#ifndef _SPSC_QUEUE_H
+#define _SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// lock-free bounded single-producer/single-consumer ring buffer
+// N must be a power of two, push() fails instead of blocking when full
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert(N && !(N & (N - 1)), "SpscQueue size must be a power of two");
+
+public:
+    bool push(const T &item)                    // producer only
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N)
+            return false;
+
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)                           // consumer only
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+
+        item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[N];
+    alignas(64) std::atomic<size_t> head{0};    // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0};    // next slot to push, written by the producer
+};
+
+#endif
\ No newline at end of file
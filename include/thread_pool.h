@@ -0,0 +1,43 @@
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "defines.h"
+
+// fixed set of worker threads for parallel loops over many small tasks,
+// the calling thread works too so a pool of 1 runs everything inline.
+// tasks are claimed one at a time from a shared counter, which balances
+// uneven tasks without any queue
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threads = 0);       // 0 uses every hardware thread
+    int size() const;                           // threads running tasks, the caller included
+    void parallelFor(int count, const std::function<void(int)> &); // task(0) ... task(count - 1), returns once all ran
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+private:
+    void work();
+    void drain();                               // runs tasks till none are left
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;               // a new loop started or the pool stops
+    std::condition_variable finished;           // the last worker left the loop
+    const std::function<void(int)> *task;
+    int count;
+    std::atomic<int> next;                      // next task to claim
+    int busy;                                   // workers still in the current loop
+    u64 generation;                             // loops started, workers run each one once
+    bool stop;
+};
+
+#endif
\ No newline at end of file
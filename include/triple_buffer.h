@@ -0,0 +1,47 @@
+#ifndef _TRIPLE_BUFFER_H
+#define _TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// lock-free single writer / single reader triple buffer
+// the writer always has a private slot to fill, publishing swaps it with the
+// shared middle slot, the reader swaps its slot with the middle one only if
+// something new was published. neither side ever waits for the other.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : state(1), back(0), front(2) {}
+
+    // writer side
+    T &writeBuffer() { return slots[back]; }    // slot owned by the writer
+    void publish()                              // hand the written slot to the reader
+    {
+        uint8_t prev = state.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = prev & INDEX;
+    }
+
+    // reader side
+    bool update()                               // true if a newer slot was published since last call
+    {
+        if (!(state.load(std::memory_order_relaxed) & FRESH))
+            return false;
+
+        uint8_t prev = state.exchange(front, std::memory_order_acq_rel);
+        front = prev & INDEX;
+        return true;
+    }
+    const T &readBuffer() const { return slots[front]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;       // index of the middle slot
+    static constexpr uint8_t FRESH = 0x4;       // middle slot wasn't read yet
+
+    T slots[3];
+    alignas(64) std::atomic<uint8_t> state;     // middle slot index | FRESH
+    alignas(64) uint8_t back;                   // writer's slot
+    alignas(64) uint8_t front;                  // reader's slot
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef _VARIANT_H
+#define _VARIANT_H
+
+#include "defines.h"
+
+// machine variants, selected at runtime by createChip8()
+enum class Variant
+{
+    CHIP8,
+    SCHIP,
+    XOCHIP
+};
+
+// compile time description of each variant, Chip8Core<Traits> only pays
+// for what its variant has: the memory array is sized by memory_size and
+// the extension opcodes are compiled out when disabled
+struct Chip8Traits
+{
+    static constexpr Variant variant = Variant::CHIP8;
+    static constexpr u32 memory_size = MEMORY_SIZE;
+    static constexpr bool schip = false;        // hires, scrolling, 16x16 sprites, flags
+    static constexpr bool xochip = false;       // 64KB, bitplanes, long I, register ranges, audio
+};
+
+struct SChipTraits
+{
+    static constexpr Variant variant = Variant::SCHIP;
+    static constexpr u32 memory_size = MEMORY_SIZE;
+    static constexpr bool schip = true;
+    static constexpr bool xochip = false;
+};
+
+struct XOChipTraits
+{
+    static constexpr Variant variant = Variant::XOCHIP;
+    static constexpr u32 memory_size = XO_MEMORY_SIZE;
+    static constexpr bool schip = true;
+    static constexpr bool xochip = true;
+};
+
+#endif
\ No newline at end of file
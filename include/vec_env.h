@@ -0,0 +1,78 @@
+#ifndef _VEC_ENV_H
+#define _VEC_ENV_H
+
+/*
+ * C interface stepping many CHIP-8 machines in lockstep for reinforcement
+ * learning, meant to be loaded from Python (ctypes, cffi) or any runtime
+ * with a C FFI. Plain C types only, so it can be included from C.
+ *
+ * Every step advances all the machines frames_per_step frames across a
+ * thread pool and writes straight into the caller's arrays, which can be
+ * numpy buffers:
+ *
+ *   observations  count * 32 * 64 bytes, one byte per pixel (palette index
+ *                 0-3, row major), hires screens keep every other pixel
+ *   rewards       count floats from the reward hook, 0 without one
+ *   dones         count bytes, 1 when the episode ended
+ *
+ * A machine whose episode ended is reset to the freshly loaded ROM at the
+ * start of the next step, before its action applies.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8ENV_WIDTH     64
+#define CHIP8ENV_HEIGHT    32
+
+/* variants, and -1 for the variant's usual quirks */
+#define CHIP8ENV_CHIP8     0
+#define CHIP8ENV_SCHIP     1
+#define CHIP8ENV_XOCHIP    2
+#define CHIP8ENV_DEFAULT_QUIRKS (-1)
+
+typedef struct chip8env chip8env;
+
+/*
+ * called on a worker thread right after machine index stepped, with the
+ * user pointer given to chip8env_set_reward. returns the step's reward and
+ * may set *done to end the episode. calls for different machines run
+ * concurrently, calls for the same machine never do.
+ */
+typedef float (*chip8env_reward_fn)(void *user, const chip8env *env, int index, uint8_t *done);
+
+/*
+ * count machines running rom, quirks is a QuirkProfile value or
+ * CHIP8ENV_DEFAULT_QUIRKS, cycles_per_frame 0 for the usual 11
+ * instructions, threads 0 for one per hardware thread. machine i starts
+ * with seed + i for CXNN. NULL if the ROM doesn't fit or an argument is off.
+ */
+chip8env *chip8env_create(const uint8_t *rom, size_t size, int count, int variant, int quirks,
+                          int frames_per_step, int cycles_per_frame, int threads, uint64_t seed);
+void chip8env_destroy(chip8env *);
+
+int chip8env_count(const chip8env *);
+void chip8env_set_reward(chip8env *, chip8env_reward_fn, void *user);
+
+/* restarts every episode and writes the first observations */
+void chip8env_reset(chip8env *, uint8_t *observations);
+
+/*
+ * actions holds count keypad bitmasks, bit k down means key k is pressed
+ * for the whole step. rewards and dones may be NULL.
+ */
+void chip8env_step(chip8env *, const uint16_t *actions, uint8_t *observations, float *rewards, uint8_t *dones);
+
+/* machine state for reward hooks: memory bytes (the address wraps) and V registers */
+uint8_t chip8env_peek(const chip8env *, int index, uint32_t address);
+uint8_t chip8env_register(const chip8env *, int index, int x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef _WORKLOADS_H
+#define _WORKLOADS_H
+
+#include <vector>
+#include "defines.h"
+
+// synthetic ROMs stressing one part of the interpreter each, for benchmarks
+// and tests. they loop forever, never read keys, timers or random numbers
+// so every run is the same, and only use CHIP-8 instructions so every core
+// runs them
+enum class Workload
+{
+    ALU,                                        // 8XYN, 7XNN and skips on registers only
+    CALLS,                                      // 2NNN/00EE, a tree of calls 8 deep
+    SPRITES,                                    // DXYN over the whole screen, unaligned
+    MEMCOPY,                                    // FX65/FX55 copying blocks through the registers
+    SELF_MODIFYING,                             // rewrites an instruction every iteration
+    COUNT
+};
+
+const char *workloadName(Workload);             // "alu", "calls", "sprites", "memcopy", "smc"
+bool workloadFromName(const char *, Workload &);
+const char *workloadSource(Workload);           // assembly, see assembler.h
+std::vector<u8> workloadROM(Workload);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "../include/assembler.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+
+#define ADDRESS_SPACE 0x10000                   // XO-CHIP memory, the most a program can use
+
+typedef std::map<std::string, long> Labels;
+
+// a source line split into its parts, upper case
+struct Line
+{
+    int number;
+    std::string mnemonic;                       // empty for a line with just a label
+    std::vector<std::string> operands;
+};
+
+// operand patterns: x, y register in the second/third nibble, X both (SHR Vx
+// is 8XX6 so it shifts Vx whatever the shift quirk), b byte, a address,
+// n nibble in the last/second nibble, L "LONG" and a 16 bits address after
+// the opcode. anything else has to be the operand itself
+static const struct
+{
+    const char *mnemonic;
+    const char *pattern;
+    u16 opcode;
+} forms[] = {
+    {"CLS", "", 0x00E0},
+    {"RET", "", 0x00EE},
+    {"SCR", "", 0x00FB},
+    {"SCL", "", 0x00FC},
+    {"LOW", "", 0x00FE},
+    {"HIGH", "", 0x00FF},
+    {"SCD", "n", 0x00C0},
+    {"JP", "V0 a", 0xB000},
+    {"JP", "a", 0x1000},
+    {"CALL", "a", 0x2000},
+    {"SE", "x y", 0x5000},
+    {"SE", "x b", 0x3000},
+    {"SNE", "x y", 0x9000},
+    {"SNE", "x b", 0x4000},
+    {"LD", "x y", 0x8000},
+    {"LD", "x DT", 0xF007},
+    {"LD", "x K", 0xF00A},
+    {"LD", "x [I]", 0xF065},
+    {"LD", "x R", 0xF085},
+    {"LD", "x b", 0x6000},
+    {"LD", "I L", 0xF000},
+    {"LD", "I a", 0xA000},
+    {"LD", "DT x", 0xF015},
+    {"LD", "ST x", 0xF018},
+    {"LD", "F x", 0xF029},
+    {"LD", "HF x", 0xF030},
+    {"LD", "B x", 0xF033},
+    {"LD", "[I] x", 0xF055},
+    {"LD", "R x", 0xF075},
+    {"ADD", "I x", 0xF01E},
+    {"ADD", "x y", 0x8004},
+    {"ADD", "x b", 0x7000},
+    {"OR", "x y", 0x8001},
+    {"AND", "x y", 0x8002},
+    {"XOR", "x y", 0x8003},
+    {"SUB", "x y", 0x8005},
+    {"SHR", "X", 0x8006},
+    {"SHR", "x y", 0x8006},
+    {"SUBN", "x y", 0x8007},
+    {"SHL", "X", 0x800E},
+    {"SHL", "x y", 0x800E},
+    {"RND", "x b", 0xC000},
+    {"DRW", "x y n", 0xD000},
+    {"SKP", "x", 0xE09E},
+    {"SKNP", "x", 0xE0A1},
+    {"SAVE", "x y", 0x5002},
+    {"LOAD", "x y", 0x5003},
+    {"PLANE", "N", 0xF001},
+    {"AUDIO", "", 0xF002},
+    {"PITCH", "x", 0xF03A},
+};
+
+// operand words that can't be labels
+static const char *reserved[] = {"I", "DT", "ST", "K", "F", "HF", "B", "R", "[I]", "LONG"};
+
+static std::string trim(const std::string &text)
+{
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+static std::vector<std::string> split(const std::string &text, char separator)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (size_t end; (end = text.find(separator, start)) != std::string::npos; start = end + 1)
+        parts.push_back(trim(text.substr(start, end - start)));
+    parts.push_back(trim(text.substr(start)));
+    return parts;
+}
+
+static bool isRegister(const std::string &operand, u8 &reg)
+{
+    if (operand.size() != 2 || operand[0] != 'V' || !isxdigit((unsigned char)operand[1]))
+        return false;
+    reg = (u8)strtol(operand.c_str() + 1, nullptr, 16);
+    return true;
+}
+
+static bool isReserved(const std::string &operand)
+{
+    u8 reg;
+    if (isRegister(operand, reg))
+        return true;
+    for (const char *word : reserved)
+    {
+        if (operand == word)
+            return true;
+    }
+    return false;
+}
+
+static bool isLabel(const std::string &name)
+{
+    if (name.empty() || !(isalpha((unsigned char)name[0]) || name[0] == '_') || isReserved(name))
+        return false;
+    for (char c : name)
+    {
+        if (!isalnum((unsigned char)c) && c != '_')
+            return false;
+    }
+    return true;
+}
+
+// a number, 0x/# hex or 0b/% binary, or a label
+static bool parseTerm(const std::string &term, const Labels &labels, long &value, std::string &error)
+{
+    if (term.empty())
+    {
+        error = "missing value";
+        return false;
+    }
+    if (!isdigit((unsigned char)term[0]) && term[0] != '#' && term[0] != '%')
+    {
+        Labels::const_iterator label = labels.find(term);
+        if (label == labels.end())
+        {
+            error = "unknown label " + term;
+            return false;
+        }
+        value = label->second;
+        return true;
+    }
+
+    const char *digits = term.c_str();
+    int base = 10;
+    if (term[0] == '#' || term.compare(0, 2, "0X") == 0)
+    {
+        digits += term[0] == '#' ? 1 : 2;
+        base = 16;
+    }
+    else if (term[0] == '%' || term.compare(0, 2, "0B") == 0)
+    {
+        digits += term[0] == '%' ? 1 : 2;
+        base = 2;
+    }
+    char *end;
+    value = strtol(digits, &end, base);
+    if (*digits == '\0' || *end != '\0')
+    {
+        error = "invalid number " + term;
+        return false;
+    }
+    return true;
+}
+
+// terms added and subtracted left to right, each one may be negated
+static bool evaluate(const std::string &text, const Labels &labels, long &value, std::string &error)
+{
+    value = 0;
+    char op = '+';
+    size_t i = 0;
+    for (;;)
+    {
+        while (i < text.size() && text[i] == ' ')
+            i++;
+        bool negative = i < text.size() && text[i] == '-';
+        if (negative)
+            i++;
+        while (i < text.size() && text[i] == ' ')
+            i++;
+        size_t start = i;
+        while (i < text.size() && (isalnum((unsigned char)text[i]) || text[i] == '_' || text[i] == '#' || text[i] == '%'))
+            i++;
+
+        long term;
+        if (!parseTerm(text.substr(start, i - start), labels, term, error))
+            return false;
+        value = op == '+' ? value + (negative ? -term : term) : value - (negative ? -term : term);
+
+        while (i < text.size() && text[i] == ' ')
+            i++;
+        if (i == text.size())
+            return true;
+        if (text[i] != '+' && text[i] != '-')
+        {
+            error = "unexpected " + text.substr(i, 1) + " in " + text;
+            return false;
+        }
+        op = text[i++];
+    }
+}
+
+static bool evaluate(const std::string &text, const Labels &labels, long min, long max, long &value, std::string &error)
+{
+    if (!evaluate(text, labels, value, error))
+        return false;
+    if (value < min || value > max)
+    {
+        error = text + " out of range";
+        return false;
+    }
+    return true;
+}
+
+static bool isLong(const std::string &operand)
+{
+    return operand.compare(0, 5, "LONG ") == 0;
+}
+
+// whether the operands have the registers and words of a pattern, values are checked when encoding
+static bool matches(const std::vector<std::string> &operands, const std::vector<std::string> &pattern)
+{
+    if (operands.size() != pattern.size())
+        return false;
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        u8 reg;
+        const std::string &token = pattern[i];
+        if (token == "x" || token == "X" || token == "y")
+        {
+            if (!isRegister(operands[i], reg))
+                return false;
+        }
+        else if (token == "L")
+        {
+            if (!isLong(operands[i]))
+                return false;
+        }
+        else if (token == "b" || token == "a" || token == "n" || token == "N")
+        {
+            if (isReserved(operands[i]) || isLong(operands[i]))
+                return false;
+        }
+        else if (operands[i] != token)
+            return false;
+    }
+    return true;
+}
+
+// bytes a line assembles to, labels aren't needed to know
+static size_t sizeOf(const Line &line)
+{
+    if (line.mnemonic.empty())
+        return 0;
+    if (line.mnemonic == "DB")
+        return line.operands.size();
+    if (line.mnemonic == "DW")
+        return line.operands.size() * 2;
+    if (line.mnemonic == "LD" && line.operands.size() == 2 && isLong(line.operands[1]))
+        return 4;
+    return 2;
+}
+
+static bool encode(const Line &line, const Labels &labels, std::vector<u8> &rom, std::string &error)
+{
+    if (line.mnemonic == "DB" || line.mnemonic == "DW")
+    {
+        bool words = line.mnemonic == "DW";
+        for (const std::string &operand : line.operands)
+        {
+            long value;
+            if (!evaluate(operand, labels, words ? -0x8000 : -0x80, words ? 0xFFFF : 0xFF, value, error))
+                return false;
+            if (words)
+                rom.push_back((u8)(value >> 8));
+            rom.push_back((u8)value);
+        }
+        return true;
+    }
+
+    bool known = false;
+    for (const auto &form : forms)
+    {
+        if (line.mnemonic != form.mnemonic)
+            continue;
+        known = true;
+        std::vector<std::string> pattern;
+        if (*form.pattern)
+            pattern = split(form.pattern, ' ');
+        if (!matches(line.operands, pattern))
+            continue;
+
+        u16 opcode = form.opcode;
+        long value = 0, extra = -1;
+        for (size_t i = 0; i < pattern.size(); i++)
+        {
+            u8 reg;
+            const std::string &token = pattern[i];
+            const std::string &operand = line.operands[i];
+            if (token == "x" || token == "X")
+            {
+                isRegister(operand, reg);
+                opcode |= reg << 8 | (token == "X" ? reg << 4 : 0);
+            }
+            else if (token == "y")
+            {
+                isRegister(operand, reg);
+                opcode |= reg << 4;
+            }
+            else if (token == "b")
+            {
+                if (!evaluate(operand, labels, -0x80, 0xFF, value, error))
+                    return false;
+                opcode |= value & 0xFF;
+            }
+            else if (token == "a")
+            {
+                if (!evaluate(operand, labels, 0, 0xFFF, value, error))
+                    return false;
+                opcode |= value;
+            }
+            else if (token == "n" || token == "N")
+            {
+                if (!evaluate(operand, labels, 0, 0xF, value, error))
+                    return false;
+                opcode |= token == "n" ? value : value << 8;
+            }
+            else if (token == "L")
+            {
+                if (!evaluate(operand.substr(5), labels, 0, 0xFFFF, extra, error))
+                    return false;
+            }
+        }
+        rom.push_back((u8)(opcode >> 8));
+        rom.push_back((u8)opcode);
+        if (extra >= 0)
+        {
+            rom.push_back((u8)(extra >> 8));
+            rom.push_back((u8)extra);
+        }
+        return true;
+    }
+
+    error = known ? "invalid operands for " + line.mnemonic : "unknown instruction " + line.mnemonic;
+    return false;
+}
+
+bool assemble(const std::string &source, std::vector<u8> &rom, std::string &error)
+{
+    rom.clear();
+
+    // first pass: every label's address, from the size of what comes before it
+    std::vector<Line> lines;
+    Labels labels;
+    long address = PROGRAM_START;
+    std::vector<std::string> texts = split(source, '\n');
+    for (size_t i = 0; i < texts.size(); i++)
+    {
+        Line line;
+        line.number = (int)i + 1;
+        std::string text = texts[i].substr(0, texts[i].find(';'));
+        for (char &c : text)
+            c = c == '\t' ? ' ' : (char)toupper((unsigned char)c);
+
+        size_t colon = text.find(':');
+        if (colon != std::string::npos)
+        {
+            std::string label = trim(text.substr(0, colon));
+            if (!isLabel(label))
+            {
+                error = "line " + std::to_string(line.number) + ": invalid label " + label;
+                return false;
+            }
+            if (labels.count(label))
+            {
+                error = "line " + std::to_string(line.number) + ": label " + label + " defined twice";
+                return false;
+            }
+            labels[label] = address;
+            text = text.substr(colon + 1);
+        }
+
+        text = trim(text);
+        if (text.empty())
+            continue;
+        size_t space = text.find(' ');
+        line.mnemonic = text.substr(0, space);
+        if (space != std::string::npos)
+            line.operands = split(text.substr(space + 1), ',');
+
+        address += (long)sizeOf(line);
+        if (address > ADDRESS_SPACE)
+        {
+            error = "line " + std::to_string(line.number) + ": program past the end of memory";
+            return false;
+        }
+        lines.push_back(line);
+    }
+
+    // second pass: the bytes, every label is known
+    for (const Line &line : lines)
+    {
+        if (!encode(line, labels, rom, error))
+        {
+            error = "line " + std::to_string(line.number) + ": " + error;
+            rom.clear();
+            return false;
+        }
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "../include/capture.h"
+#include <chrono>
+#include <cstring>
+
+Capture::Capture() : running(false), frames_written(0), frames_dropped(0), file(nullptr),
+                     format(CaptureFormat::Y4M), scale(1), row(nullptr), has_previous(false)
+{
+}
+
+bool Capture::open(const char *path, CaptureFormat output, int factor, const u32 palette[4])
+{
+    close();
+    if (factor < 1)
+    {
+        return false;
+    }
+
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    format = output;
+    scale = factor;
+    row = new u8[HIRES_WIDTH * scale * 3];
+    has_previous = false;
+    frames_written = 0;
+    frames_dropped = 0;
+
+    // BT.601 studio range, what players assume for Y4M without a color tag
+    for (int i = 0; i < 4; i++)
+    {
+        colors[i] = palette[i];
+        int r = (palette[i] >> 16) & 0xFF, g = (palette[i] >> 8) & 0xFF, b = palette[i] & 0xFF;
+        yuv[i][0] = (u8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        yuv[i][1] = (u8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        yuv[i][2] = (u8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    if (format == CaptureFormat::Y4M)
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", HIRES_WIDTH * scale, HIRES_HEIGHT * scale, TIMER_HZ);
+    else if (format == CaptureFormat::RLE)
+        fwrite("C8RL", 1, 4, file);
+
+    running.store(true, std::memory_order_release);
+    worker = std::thread(&Capture::encode, this);
+    return true;
+}
+
+// a full queue means the disk can't keep up, the frame is dropped rather
+// than making the emulation wait
+void Capture::submit(const Frame &frame)
+{
+    if (!queue.push(frame))
+        frames_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Capture::close()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    running.store(false, std::memory_order_release);
+    worker.join();
+    fclose(file);
+    file = nullptr;
+    delete[] row;
+    row = nullptr;
+}
+
+bool Capture::isOpen() const
+{
+    return file != nullptr;
+}
+
+u64 Capture::written() const
+{
+    return frames_written.load(std::memory_order_relaxed);
+}
+
+u64 Capture::dropped() const
+{
+    return frames_dropped.load(std::memory_order_relaxed);
+}
+
+Capture::~Capture()
+{
+    close();
+}
+
+// drains the queue, then naps, the last frames are flushed after close()
+void Capture::encode()
+{
+    Frame frame;
+    while (true)
+    {
+        bool stopping = !running.load(std::memory_order_acquire);
+        while (queue.pop(frame))
+        {
+            write(frame);
+            frames_written.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (stopping)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(CAPTURE_POLL_MS));
+    }
+    fflush(file);
+}
+
+void Capture::write(const Frame &frame)
+{
+    if (format == CaptureFormat::RLE)
+        writeRLE(frame);
+    else
+        writeImage(frame);
+}
+
+// every frame is scaled to the hires size, each row is built once and
+// written scale times
+void Capture::writeImage(const Frame &frame)
+{
+    // composited to palette indices, then mapped to RGB or YCbCr
+    static const u32 indices[4] = {0, 1, 2, 3};
+    expandFrame(frame, indices, 1, pixels, frame.width);
+    int factor = scale * (HIRES_WIDTH / frame.width);
+    int width = HIRES_WIDTH * scale;
+
+    if (format == CaptureFormat::Y4M)
+    {
+        // planar, all the Y rows then Cb then Cr
+        fwrite("FRAME\n", 1, 6, file);
+        for (int c = 0; c < 3; c++)
+        {
+            for (int y = 0; y < frame.height; y++)
+            {
+                const u32 *line = &pixels[y * frame.width];
+                for (int x = 0; x < frame.width; x++)
+                    memset(&row[x * factor], yuv[line[x]][c], factor);
+                for (int i = 0; i < factor; i++)
+                    fwrite(row, 1, width, file);
+            }
+        }
+        return;
+    }
+
+    for (int y = 0; y < frame.height; y++)
+    {
+        const u32 *line = &pixels[y * frame.width];
+        u8 *out = row;
+        for (int x = 0; x < frame.width; x++)
+        {
+            u32 color = colors[line[x]];
+            for (int i = 0; i < factor; i++)
+            {
+                *out++ = (u8)(color >> 16);
+                *out++ = (u8)(color >> 8);
+                *out++ = (u8)color;
+            }
+        }
+        for (int i = 0; i < factor; i++)
+            fwrite(row, 1, width * 3, file);
+    }
+}
+
+// after the "C8RL" magic, each frame is
+//   u8 width, u8 height, u8 runs
+//   runs * {u8 first row, u8 rows, rows * PLANES_COUNT * ROW_WORDS * 8 bytes}
+// a row is plane 0 then plane 1, words big endian so the bytes read left to
+// right. a frame with no change is just its 3 bytes header, a resolution
+// change sends every row.
+void Capture::writeRLE(const Frame &frame)
+{
+    bool full = !has_previous || previous.width != frame.width || previous.height != frame.height;
+    auto changed = [&](int y)
+    {
+        return full || memcmp(frame.planes[0][y], previous.planes[0][y], sizeof(frame.planes[0][y])) != 0 ||
+               memcmp(frame.planes[1][y], previous.planes[1][y], sizeof(frame.planes[1][y])) != 0;
+    };
+
+    // runs of consecutive changed rows, collected first to write the count
+    u8 starts[HIRES_HEIGHT], lengths[HIRES_HEIGHT];
+    int runs = 0;
+    for (int y = 0; y < frame.height; y++)
+    {
+        if (!changed(y))
+            continue;
+        if (runs && starts[runs - 1] + lengths[runs - 1] == y)
+        {
+            lengths[runs - 1]++;
+        }
+        else
+        {
+            starts[runs] = (u8)y;
+            lengths[runs] = 1;
+            runs++;
+        }
+    }
+
+    u8 header[3] = {frame.width, frame.height, (u8)runs};
+    fwrite(header, 1, sizeof(header), file);
+    for (int r = 0; r < runs; r++)
+    {
+        u8 run[2] = {starts[r], lengths[r]};
+        fwrite(run, 1, sizeof(run), file);
+        for (int y = starts[r]; y < starts[r] + lengths[r]; y++)
+        {
+            u8 bytes[PLANES_COUNT * ROW_WORDS * 8];
+            u8 *out = bytes;
+            for (int p = 0; p < PLANES_COUNT; p++)
+            {
+                for (int w = 0; w < ROW_WORDS; w++)
+                {
+                    for (int k = 56; k >= 0; k -= 8)
+                        *out++ = (u8)(frame.planes[p][y][w] >> k);
+                }
+            }
+            fwrite(bytes, 1, sizeof(bytes), file);
+        }
+    }
+
+    previous = frame;
+    has_previous = true;
+}
+
+bool captureFormatFromName(const char *name, CaptureFormat &format)
+{
+    if (strcmp(name, "y4m") == 0)
+        format = CaptureFormat::Y4M;
+    else if (strcmp(name, "rgb") == 0)
+        format = CaptureFormat::RGB;
+    else if (strcmp(name, "rle") == 0)
+        format = CaptureFormat::RLE;
+    else
+        return false;
+    return true;
+}
\ No newline at end of file
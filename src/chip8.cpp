@@ -1,762 +1,1734 @@
-#include "../include/chip8.h"
-
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <random>
-#include <cstring>
-
-Chip8::Chip8()
-{
-    // initalize program counter
-    pc = PROGRAM_START;
-
-    // intilize the: V, keypad, memory, stack, display
-    memset(V, 0, sizeof(V));
-    memset(keypad, 0, sizeof(keypad));
-    memset(memory, 0, sizeof(memory));
-    memset(stack, 0, sizeof(stack));
-    memset(display, 0, sizeof(display));
-
-    // write fonts into memory
-    initFonts();
-}
-
-// load ROM into memory starting from PROGRAM_START
-bool Chip8::loadROM(char *path)
-{
-    // open file for reading in binary mode
-    std::ifstream program_file(path, std::ios::binary | std::ios::in);
-    if (!program_file.is_open())
-    {
-        return false;
-    }
-
-    // use then cast as there is no get(uint8_t)
-    char instr;
-    for (int i = 0; program_file.get(instr); i++)
-    {
-        if (PROGRAM_START + i == MEMORY_SIZE)
-        {
-            // no enough space for the program
-            return false;
-        }
-        memory[PROGRAM_START + i] = (u8)instr;
-    }
-    program_file.close();
-    return true;
-}
-
-// runs one clock fetch/execute cycle
-void Chip8::clock(bool &draw, bool &sound)
-{
-    // fetch current instruction
-    // append two bytes, to get full instruction
-    u8 hi = memory[pc];
-    u8 lo = memory[pc + 1];
-    opcode = (u16)(hi << 8u) | (lo);
-
-    // go to next instruction
-    pc += 2;
-
-    // decode current instruction
-    // 1234: nibbles numbered from left to right
-    u8 first_nibble = (opcode & 0xF000u) >> 12u;
-    u8 second_nibble = (opcode & 0x0F00u) >> 8u;
-    u8 third_nibble = (opcode & 0x00F0u) >> 4u;
-    u8 fourth_nibble = (opcode & 0x000Fu);
-    u8 last_two = (opcode & 0x00FFu);
-
-    // storing the executed code for debugging
-    std::string executed;
-
-    // execute the fetched instruction
-    switch (first_nibble)
-    {
-    case 0x0:
-        group_0(fourth_nibble, executed);
-        break;
-    case 0x1:
-        executed = "1NNN";
-        op_1NNN();
-        break;
-    case 0x2:
-        executed = "2NNN";
-        op_2NNN();
-        break;
-    case 0x3:
-        executed = "3XNN";
-        op_3XNN();
-        break;
-    case 0x4:
-        executed = "4XNN";
-        op_4XNN();
-        break;
-    case 0x5:
-        executed = "5XY0";
-        op_5XY0();
-        break;
-    case 0x6:
-        executed = "6XNN";
-        op_6XNN();
-        break;
-    case 0x7:
-        executed = "7XNN";
-        op_7XNN();
-        break;
-    case 0x8:
-        group_8(fourth_nibble, executed);
-        break;
-    case 0x9:
-        executed = "9XY0";
-        op_9XY0();
-        break;
-    case 0xA:
-        executed = "ANNN";
-        op_ANNN();
-        break;
-    case 0xB:
-        executed = "BNNN";
-        op_BNNN();
-        break;
-    case 0xC:
-        executed = "CXNN";
-        op_CXNN();
-        break;
-    case 0xD:
-        draw = true;
-        executed = "DXYN";
-        op_DXYN();
-        break;
-    case 0xE:
-        group_E(fourth_nibble, executed);
-        break;
-    case 0xF:
-        group_F(last_two, executed);
-        break;
-    default:
-        executed = NO_OPCODE;
-        break;
-    }
-
-    // debugging
-    if (executed == NO_OPCODE)
-        debug_print("[FAILED] Unknown opcode: 0x%X\n", opcode);
-    else
-        debug_print("[OK] %s: 0x%X\n", executed.c_str(), opcode);
-
-    // update timers
-    if (delay_timer)
-    {
-        delay_timer--;
-    }
-    if (sound_timer)
-    {
-        if (sound_timer == 1)
-            sound = true;
-        sound_timer--;
-    }
-}
-
-void Chip8::initFonts()
-{
-    for (int i = 0; i < FONTS_COUNT; i++)
-    {
-        memory[FONTS_START + i] = font_sprite[i];
-    }
-}
-//----------------------------------------------------------------------------------
-
-// extract ?(NNN)
-u16 Chip8::address()
-{
-    return (opcode & 0x0FFFu);
-}
-
-// extract ??(NN)
-u8 Chip8::value()
-{
-    return (opcode & 0x00FFu);
-}
-
-// extract ?(X)??
-u8 Chip8::regx()
-{
-    return (opcode & 0x0F00u) >> 8u;
-}
-
-// extract ??(Y)?
-u8 Chip8::regy()
-{
-    return (opcode & 0x00F0u) >> 4u;
-}
-//----------------------------------------------------------------------------------
-
-// left most bit
-u8 Chip8::msb(u8 reg)
-{
-    return (reg & 0x80u) >> 7u;
-}
-
-// right most bit
-u8 Chip8::lsb(u8 reg)
-{
-    return (reg & 0x1u);
-}
-/**********************************************************************************/
-
-// clear display
-void Chip8::op_00E0()
-{
-    memset(display, 0, sizeof(display));
-}
-
-// uncoditional jump
-void Chip8::op_1NNN()
-{
-    pc = address();
-}
-
-// jump to subroutine
-void Chip8::op_2NNN()
-{
-    // push to stack and jump
-    stack[sp] = pc;
-    sp++;
-    pc = address();
-}
-
-// return from subroutine
-void Chip8::op_00EE()
-{
-    // pop and return
-    sp--;
-    pc = stack[sp];
-}
-
-// if (Vx == NN) pc+=2
-void Chip8::op_3XNN()
-{
-    u8 x = regx();
-    u8 NN = value();
-
-    if (V[x] == NN)
-    {
-        pc += 2;
-    }
-}
-
-// if (Vx != NN) pc+=2
-void Chip8::op_4XNN()
-{
-    u8 x = regx();
-    u8 NN = value();
-
-    if (V[x] != NN)
-    {
-        pc += 2;
-    }
-}
-
-// if (Vx == Vy) pc+=2
-void Chip8::op_5XY0()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    if (V[x] == V[y])
-    {
-        pc += 2;
-    }
-}
-
-// if (Vx != Vy) pc+=2
-void Chip8::op_9XY0()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    if (V[x] != V[y])
-    {
-        pc += 2;
-    }
-}
-
-// vx = NN
-void Chip8::op_6XNN()
-{
-    u8 x = regx();
-    u8 NN = value();
-
-    V[x] = NN;
-}
-
-// vx += NN (Vf isn't affected)
-void Chip8::op_7XNN()
-{
-    u8 x = regx();
-    u8 NN = value();
-
-    V[x] += NN;
-}
-
-// Vx = Vy
-void Chip8::op_8XY0()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    V[x] = V[y];
-}
-
-// Vx |= Vy
-void Chip8::op_8XY1()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    // V[0xF] = 0;       // Quirk
-    V[x] |= V[y];
-}
-
-// Vx &= Vy
-void Chip8::op_8XY2()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    // V[0xF] = 0;       // Quirk
-    V[x] &= V[y];
-}
-
-// Vx &= Vy
-void Chip8::op_8XY3()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    // V[0xF] = 0;     // Quirk
-    V[x] ^= V[y];
-}
-
-// Vx += Vy, vf: affected
-void Chip8::op_8XY4()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    u16 sum = (V[x] + V[y]);
-
-    V[x] = (u8)(sum & 0xFFu);
-
-    if (sum > 0xFFu)
-    {
-        V[0xF] = 1;
-    }
-    else
-    {
-        V[0xF] = 0;
-    }
-}
-
-// Vx -= Vy, vf: affected
-void Chip8::op_8XY5()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    u8 old_val = V[x];
-
-    V[x] = V[x] - V[y];
-
-    if (old_val >= V[y])
-    {
-        V[0xF] = 1;
-    }
-    else
-    {
-        V[0xF] = 0;
-    }
-}
-
-// Vx >>= 1, vf: affected
-void Chip8::op_8XY6()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    V[x] = V[y];
-    u8 old_val = V[x];
-
-    V[x] >>= 1;
-    V[0xF] = lsb(old_val);
-}
-
-// Vx = Vy - Vx, Vf: affected
-void Chip8::op_8XY7()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    u8 old_val = V[y];
-
-    V[x] = V[y] - V[x];
-
-    if (old_val >= V[x])
-    {
-        V[0xF] = 1;
-    }
-    else
-    {
-        V[0xF] = 0;
-    }
-}
-
-// Vx <<= 1, vf: affected
-void Chip8::op_8XYE()
-{
-    u8 x = regx();
-    u8 y = regy();
-
-    V[x] = V[y];
-    u8 old_val = V[x];
-
-    V[x] <<= 1;
-    V[0xF] = msb(old_val);
-}
-
-// I = NNN
-void Chip8::op_ANNN()
-{
-    index = address();
-}
-
-// unconditional jump to (V0 + NNN)
-void Chip8::op_BNNN()
-{
-    pc = address() + V[0];
-}
-
-// Vx = rand() & NN
-void Chip8::op_CXNN()
-{
-    u8 x = regx();
-    u8 NN = value();
-
-    V[x] = (rand() % 256) & NN;
-}
-
-// draws N bytes read starting from I->I+N
-// vf: affected, I: not affected
-void Chip8::op_DXYN()
-{
-    u8 x = regx();
-    u8 y = regy();
-    u8 n = (opcode & 0x000Fu);
-
-    V[0xF] = 0;
-
-    // V[x], V[y] top left corner
-    // V[x]+n-1, V[y]+8-1 bottom right corner
-    // cell numbering is reversed here
-    // (10, 4) means at 10th column, 4th row
-    for (int i = 0; i < n; i++)
-    {
-        if ((unsigned int)(index + i) >= MEMORY_SIZE)
-        {
-            std::cerr << "Chip8::op_DXYN() ,index out of bounds";
-            exit(1);
-        }
-
-        // clipping
-        if (V[y] % DISPLAY_HEIGHT + i == DISPLAY_HEIGHT)
-            break;
-
-        u8 sprite = memory[index + i];
-        for (int j = 0; j < 8; j++)
-        {
-            u8 pixel = sprite & (0x80u >> j); // numbering starts from left
-            u32 pixel_idx = (V[x] % DISPLAY_WIDHT + j) + (V[y] % DISPLAY_HEIGHT + i) * DISPLAY_WIDHT;
-
-            // clipping
-            if (V[x] % DISPLAY_WIDHT + j == DISPLAY_WIDHT)
-                break;
-
-            // All the pixels that are “on” in the sprite will flip the pixels on the screen
-            if (pixel)
-            {
-                // on -> off: flag
-                if (display[pixel_idx])
-                {
-                    V[0xF] = 1;
-                }
-                display[pixel_idx] ^= 0xFFu;
-            }
-        }
-    }
-}
-
-// if (key() == Vx) pc+=2
-void Chip8::op_EX9E()
-{
-    u8 x = regx();
-
-    if (keypad[V[x]])
-    {
-        pc += 2;
-    }
-}
-
-// if (key() != Vx) pc+=2
-void Chip8::op_EXA1()
-{
-    u8 x = regx();
-
-    if (!keypad[V[x]])
-    {
-        pc += 2;
-    }
-}
-
-// Vx = get_key()
-void Chip8::op_FX0A()
-{
-    u8 x = regx();
-
-    bool pressed = 0;
-    for (int i = 0; i < 16; i++)
-    {
-        if (keypad[i])
-        {
-            pressed = 1;
-            V[x] = (u8)i;
-            break;
-        }
-    }
-
-    // stay in same instruction till get input
-    if (!pressed)
-    {
-        pc -= 2;
-    }
-}
-
-// Vx = delay_timer
-void Chip8::op_FX07()
-{
-    u8 x = regx();
-
-    V[x] = delay_timer;
-}
-
-// delay_timer = Vx
-void Chip8::op_FX15()
-{
-    u8 x = regx();
-
-    delay_timer = V[x];
-}
-
-// sound_timer = Vx
-void Chip8::op_FX18()
-{
-    u8 x = regx();
-
-    sound_timer = V[x];
-}
-
-// I = I + Vx         :Vf=1 if there is overflow
-void Chip8::op_FX1E()
-{
-    u8 x = regx();
-
-    index = index + V[x];
-
-    if (index >= MEMORY_SIZE)
-    {
-        V[0xF] = 1;
-    }
-    else
-    {
-        V[0xF] = 0;
-    }
-}
-
-// I = sprite_addr[Vx], reads font
-void Chip8::op_FX29()
-{
-    u8 x = regx();
-
-    index = FONTS_START + 5 * V[x];
-}
-
-// if vx = 159: mem[i+0] = 1, mem[i+1] = 5, mem[i+2] = 9
-// BCD, Binary coded decimal
-void Chip8::op_FX33()
-{
-    u8 x = regx();
-    int num = (int)V[x];
-    std::cout << num << "\n";
-    memory[index + 2] = (u8)(num % 10);
-    num /= 10;
-
-    memory[index + 1] = (u8)(num % 10);
-    num /= 10;
-
-    memory[index + 0] = (u8)(num % 10);
-    std::cout << (int)memory[index] << " " << (int)memory[index + 1] << " " << (int)memory[index + 2] << '\n';
-    // exit(1);
-}
-
-// mem[i]=v0, mem[i+1]=v1...mem[i+x]=vx. I: doesn't change
-void Chip8::op_FX55()
-{
-    u8 x = regx();
-
-    for (int i = 0; i <= x; i++)
-    {
-        memory[index + i] = V[i];
-    }
-    if (QUIRK)
-        index += x + 1;
-}
-
-void Chip8::op_FX65()
-{
-    u8 x = regx();
-
-    for (int i = 0; i <= x; i++)
-    {
-        V[i] = memory[index + i];
-    }
-    if (QUIRK)
-        index += x + 1;
-}
-
-void Chip8::group_0(u8 fourth_nibble, std::string &executed)
-{
-    switch (fourth_nibble)
-    {
-    case 0x0:
-        executed = "00E0";
-        op_00E0();
-        break;
-    case 0xE:
-        executed = "00EE";
-        op_00EE();
-        break;
-    default:
-        executed = NO_OPCODE;
-        break;
-    }
-}
-
-void Chip8::group_8(u8 fourth_nibble, std::string &executed)
-{
-    switch (fourth_nibble)
-    {
-    case 0x0:
-        executed = "8XY0";
-        op_8XY0();
-        break;
-    case 0x1:
-        executed = "8XY1";
-        op_8XY1();
-        break;
-    case 0x2:
-        executed = "8XY2";
-        op_8XY2();
-        break;
-    case 0x3:
-        executed = "8XY3";
-        op_8XY3();
-        break;
-    case 0x4:
-        executed = "8XY4";
-        op_8XY4();
-        break;
-    case 0x5:
-        executed = "8XY5";
-        op_8XY5();
-        break;
-    case 0x6:
-        executed = "8XY6";
-        op_8XY6();
-        break;
-    case 0x7:
-        executed = "8XY7";
-        op_8XY7();
-        break;
-    case 0xE:
-        executed = "8XYE";
-        op_8XYE();
-        break;
-    default:
-        executed = NO_OPCODE;
-        break;
-    }
-}
-
-void Chip8::group_E(u8 fourth_nibble, std::string &executed)
-{
-    switch (fourth_nibble)
-    {
-    case 0xE:
-        executed = "EX9E";
-        op_EX9E();
-        break;
-    case 0x1:
-        executed = "EXA1";
-        op_EXA1();
-        break;
-    default:
-        executed = NO_OPCODE;
-        break;
-    }
-}
-
-void Chip8::group_F(u8 last_two, std::string &executed)
-{
-    switch (last_two)
-    {
-    case 0x07:
-        executed = "FX07";
-        op_FX07();
-        break;
-    case 0x0A:
-        executed = "FX0A";
-        op_FX0A();
-        break;
-    case 0x15:
-        executed = "FX15";
-        op_FX15();
-        break;
-    case 0x18:
-        executed = "FX18";
-        op_FX18();
-        break;
-    case 0x1E:
-        executed = "FX1E";
-        op_FX1E();
-        break;
-    case 0x29:
-        executed = "FX29";
-        op_FX29();
-        break;
-    case 0x33:
-        executed = "FX33";
-        op_FX33();
-        break;
-    case 0x55:
-        executed = "FX55";
-        op_FX55();
-        break;
-    case 0x65:
-        executed = "FX65";
-        op_FX65();
-        break;
-    default:
-        executed = NO_OPCODE;
-        break;
-    }
+#include "../include/chip8.h"
+
+#include <algorithm>
+#include <string>
+#include <cstring>
+
+Chip8::Chip8()
+{
+    // initalize program counter
+    pc = PROGRAM_START;
+    index = 0;
+    opcode = 0;
+    sp = 0;
+    delay_timer = 0;
+    sound_timer = 0;
+    waiting = false;
+    wait_reg = 0;
+    plane = 1;
+    pitch = PATTERN_PITCH;
+    pattern_loaded = false;
+    vblank = false;
+    rng.seed(RNG_DEFAULT_SEED);
+    faults = 0;
+    trap = 0;
+    breakpoint = NO_BREAKPOINT;
+    memory_hash = 0;
+    display_hash = 0;
+    memory_stale = true;
+    display_stale = true;
+
+    // intilize the: V, keypad, stack, display
+    memset(V, 0, sizeof(V));
+    memset(keypad, 0, sizeof(keypad));
+    memset(stack, 0, sizeof(stack));
+    memset(flags, 0, sizeof(flags));
+    memset(pattern, 0, sizeof(pattern));
+    setResolution(DISPLAY_WIDHT, DISPLAY_HEIGHT);
+}
+
+template <typename Traits, typename Quirks>
+Chip8Core<Traits, Quirks>::Chip8Core() : budget(0)
+{
+    memset(memory, 0, sizeof(memory));
+
+    // write fonts into memory
+    initFonts();
+}
+
+template <typename Traits, typename Quirks>
+Variant Chip8Core<Traits, Quirks>::variant() const
+{
+    return Traits::variant;
+}
+
+template <typename Traits, typename Quirks>
+QuirkProfile Chip8Core<Traits, Quirks>::quirks() const
+{
+    return Quirks::profile;
+}
+
+template <typename Traits, typename Quirks>
+u8 *Chip8Core<Traits, Quirks>::program(size_t &capacity)
+{
+    capacity = Traits::memory_size - PROGRAM_START;
+    return &memory[PROGRAM_START];
+}
+
+// state hashing: every memory byte and display word gets a key from its
+// position and value, and the hashes are the XOR of all the keys. changing
+// one byte or word swaps its old key for the new one, no rescan needed
+static inline u64 hashMix(u64 z)
+{
+    // splitmix64's finalizer, a bijection so distinct inputs give distinct keys
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline u64 memoryKey(u32 address, u8 value)
+{
+    return hashMix(((u64)address << 8) | value);
+}
+
+static inline u64 displayKey(u32 slot, u64 word)
+{
+    return hashMix(word ^ (slot * 0x9E3779B97F4A7C15ull + 0x7F4A7C15ull));
+}
+
+// the memory sizes are powers of two, so masking the address wraps it at
+// the end of memory the way the 12/16-bit address bus would. every access
+// is in bounds with no branch, wrapping only sets the sticky fault
+template <typename Traits, typename Quirks>
+inline u8 &Chip8Core<Traits, Quirks>::at(u32 address)
+{
+    static_assert((Traits::memory_size & (Traits::memory_size - 1)) == 0, "memory_size must be a power of two");
+    faults |= (u8)((address >= Traits::memory_size) << (int)Fault::MEMORY);
+    return memory[address & (Traits::memory_size - 1)];
+}
+
+template <typename Traits, typename Quirks>
+inline void Chip8Core<Traits, Quirks>::store(u32 address, u8 value)
+{
+    u8 &cell = at(address);
+    u32 wrapped = address & (Traits::memory_size - 1);
+    memory_hash ^= memoryKey(wrapped, cell) ^ memoryKey(wrapped, value);
+    cell = value;
+}
+
+// runs one clock fetch/execute cycle
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::clock(bool &draw)
+{
+    // FX0A is pending, nothing gets fetched till a key is pressed
+    if (waiting && !resolveWait())
+        return;
+
+    // the last DXYN waits for the vertical blank
+    if constexpr (Quirks::display_wait)
+    {
+        if (vblank)
+            return;
+    }
+
+    execute(draw);
+}
+
+// forced inline so step() has the whole dispatch in the run loop. the name
+// of the instruction is only read by the DEBUG trace, without it the
+// assignments are dead and compile away
+template <typename Traits, typename Quirks>
+FORCE_INLINE void Chip8Core<Traits, Quirks>::execute(bool &draw)
+{
+    // fetch current instruction
+    // append two bytes, to get full instruction
+    u8 hi = at(pc);
+    u8 lo = at(pc + 1u);
+    opcode = (u16)(hi << 8u) | (lo);
+
+    // go to next instruction
+    pc += 2;
+
+    // decode current instruction
+    // 1234: nibbles numbered from left to right
+    u8 first_nibble = (opcode & 0xF000u) >> 12u;
+    u8 fourth_nibble = (opcode & 0x000Fu);
+    u8 last_two = (opcode & 0x00FFu);
+
+    // the executed instruction for the trace
+    const char *executed = NO_OPCODE;
+
+    // execute the fetched instruction
+    switch (first_nibble)
+    {
+    case 0x0:
+        group_0(last_two, executed);
+        break;
+    case 0x1:
+        executed = "1NNN";
+        op_1NNN();
+        break;
+    case 0x2:
+        executed = "2NNN";
+        op_2NNN();
+        break;
+    case 0x3:
+        executed = "3XNN";
+        op_3XNN();
+        break;
+    case 0x4:
+        executed = "4XNN";
+        op_4XNN();
+        break;
+    case 0x5:
+        group_5(fourth_nibble, executed);
+        break;
+    case 0x6:
+        executed = "6XNN";
+        op_6XNN();
+        break;
+    case 0x7:
+        executed = "7XNN";
+        op_7XNN();
+        break;
+    case 0x8:
+        group_8(fourth_nibble, executed);
+        break;
+    case 0x9:
+        executed = "9XY0";
+        op_9XY0();
+        break;
+    case 0xA:
+        executed = "ANNN";
+        op_ANNN();
+        break;
+    case 0xB:
+        executed = "BNNN";
+        op_BNNN();
+        break;
+    case 0xC:
+        executed = "CXNN";
+        op_CXNN();
+        break;
+    case 0xD:
+        draw = true;
+        executed = "DXYN";
+        op_DXYN();
+        break;
+    case 0xE:
+        group_E(fourth_nibble, executed);
+        break;
+    case 0xF:
+        group_F(last_two, executed);
+        break;
+    default:
+        illegalOpcode();
+        break;
+    }
+
+    // cycle timing: charge what the VIP interpreter took for it
+    if constexpr (Quirks::cycle_timing)
+        budget -= (int)vipCycles();
+
+    // debugging
+    if (DEBUG)
+    {
+        if (trap & (1u << (int)Fault::ILLEGAL_OPCODE))
+            debug_print("[FAILED] Unknown opcode: 0x%X\n", opcode);
+        else
+            debug_print("[OK] %s: 0x%X\n", executed, opcode);
+    }
+}
+
+template <typename Traits, typename Quirks>
+inline void Chip8Core<Traits, Quirks>::illegalOpcode()
+{
+    trap |= 1u << (int)Fault::ILLEGAL_OPCODE;
+    faults |= trap;
+}
+
+// the run loop's body: the FX0A and vblank checks, then execute() inlined,
+// and the common case costs a single test of everything that can stop the loop
+template <typename Traits, typename Quirks>
+FORCE_INLINE bool Chip8Core<Traits, Quirks>::step(RunResult &result, bool stop_on_draw)
+{
+    // FX0A is pending and no key is down
+    if (waiting && !resolveWait())
+    {
+        result.reason = StopReason::WAITING;
+        return false;
+    }
+
+    // the last DXYN waits for the vertical blank, nothing else runs this frame
+    if constexpr (Quirks::display_wait)
+    {
+        if (vblank)
+        {
+            result.reason = StopReason::FRAME;
+            return false;
+        }
+    }
+
+    bool draw = false;
+    execute(draw);
+    result.cycles++;
+    result.drew |= draw;
+
+    if (trap | (pc == breakpoint) | (draw & stop_on_draw))
+    {
+        if (trap & (1u << (int)Fault::ILLEGAL_OPCODE))
+            result.reason = StopReason::ILLEGAL_OPCODE;
+        else if (trap & (1u << (int)Fault::STACK))
+            result.reason = StopReason::STACK_FAULT;
+        else if (pc == breakpoint)
+            result.reason = StopReason::BREAKPOINT;
+        else
+            result.reason = StopReason::DRAW;
+        trap = 0;
+        return false;
+    }
+    return true;
+}
+
+template <typename Traits, typename Quirks>
+RunResult Chip8Core<Traits, Quirks>::run(u32 max_cycles, bool stop_on_draw)
+{
+    RunResult result = {StopReason::BUDGET, 0, false};
+    trap = 0;                                   // left by a clock() outside of the loop
+    while (result.cycles < max_cycles)
+    {
+        if (!step(result, stop_on_draw))
+            break;
+    }
+    return result;
+}
+
+template <typename Traits, typename Quirks>
+RunResult Chip8Core<Traits, Quirks>::runFrame(int instructions, u32 limit)
+{
+    RunResult result = {StopReason::FRAME, 0, false};
+    trap = 0;
+
+    if constexpr (Quirks::cycle_timing)
+    {
+        // the frame lasts VIP_FRAME_CYCLES machine cycles, what the last
+        // instruction overran comes out of the next frame. DXYN stalls till
+        // the vertical blank and FX0A idles, both use up the rest of the frame
+        budget += VIP_FRAME_CYCLES;
+        while (budget > 0 && result.cycles < limit)
+        {
+            if (!step(result, false))
+                break;
+        }
+        if ((vblank || waiting) && result.cycles < limit)
+            budget = 0;
+        (void)instructions;
+    }
+    else
+    {
+        // stops early if FX0A starts waiting
+        u32 count = std::min((u32)instructions, limit);
+        while (result.cycles < count)
+        {
+            if (!step(result, false))
+                break;
+        }
+    }
+    return result;
+}
+
+template <typename Traits, typename Quirks>
+u64 Chip8Core<Traits, Quirks>::memoryHash() const
+{
+    u64 hash = 0;
+    for (u32 address = 0; address < Traits::memory_size; address++)
+        hash ^= memoryKey(address, memory[address]);
+    return hash;
+}
+
+// only a ROM load or a clear/scroll makes it rescan memory or the display
+template <typename Traits, typename Quirks>
+u64 Chip8Core<Traits, Quirks>::stateHash()
+{
+    if (memory_stale)
+    {
+        memory_hash = memoryHash();
+        memory_stale = false;
+    }
+    if (display_stale)
+    {
+        display_hash = displayHash();
+        display_stale = false;
+    }
+    return memory_hash ^ display_hash ^ registersHash() ^ hashMix((u64)(u32)budget);
+}
+
+template <typename Traits, typename Quirks>
+u64 Chip8Core<Traits, Quirks>::fullStateHash() const
+{
+    return memoryHash() ^ displayHash() ^ registersHash() ^ hashMix((u64)(u32)budget);
+}
+
+template <typename Traits, typename Quirks>
+u8 Chip8Core<Traits, Quirks>::peek(u32 address) const
+{
+    return memory[address & (Traits::memory_size - 1)];
+}
+
+template <typename Traits, typename Quirks>
+size_t Chip8Core<Traits, Quirks>::stateSize() const
+{
+    return sizeof(StateHeader) + registersSize() + sizeof(budget) + sizeof(memory);
+}
+
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::saveState(u8 *out) const
+{
+    StateHeader header = {STATE_MAGIC, STATE_VERSION, (u8)Traits::variant, (u8)Quirks::profile, 0, (u32)stateSize()};
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+
+    saveRegisters(out);
+    memcpy(out, &budget, sizeof(budget));
+    memcpy(out + sizeof(budget), memory, sizeof(memory));
+}
+
+template <typename Traits, typename Quirks>
+bool Chip8Core<Traits, Quirks>::loadState(const u8 *in, size_t size)
+{
+    StateHeader header;
+    if (size != stateSize())
+    {
+        return false;
+    }
+    memcpy(&header, in, sizeof(header));
+    if (header.magic != STATE_MAGIC || header.version != STATE_VERSION || header.size != size ||
+        header.variant != (u8)Traits::variant || header.quirks != (u8)Quirks::profile)
+    {
+        return false;
+    }
+    in += sizeof(header);
+
+    loadRegisters(in);
+    memcpy(&budget, in, sizeof(budget));
+    memcpy(memory, in + sizeof(budget), sizeof(memory));
+    return true;
+}
+
+// machine cycles (8 clocks of the 1.76MHz 1802) the VIP interpreter spends
+// on each instruction, fetch and decode included. these are its average
+// costs, DXYN and FX55/FX65 also scale with their rows and registers and
+// DXYN costs more for sprites straddling two display bytes
+template <typename Traits, typename Quirks>
+u32 Chip8Core<Traits, Quirks>::vipCycles() const
+{
+    switch (opcode >> 12)
+    {
+    case 0x0:
+        return opcode == 0x00E0 ? 24 : 23;
+    case 0x1:
+    case 0x2:
+    case 0xB:
+        return 23;
+    case 0x3:
+    case 0x4:
+    case 0xA:
+        return 12;
+    case 0x5:
+    case 0x9:
+    case 0xE:
+        return 16;
+    case 0x6:
+        return 6;
+    case 0x7:
+        return 10;
+    case 0x8:
+        return 44;
+    case 0xC:
+        return 36;
+    case 0xD:
+        return 26 + (opcode & 0x000Fu) * ((V[(opcode & 0x0F00u) >> 8u] & 7u) ? 14 : 9);
+    default:
+        switch (opcode & 0x00FFu)
+        {
+        case 0x1E:
+            return 19;
+        case 0x29:
+            return 20;
+        case 0x33:
+            return 204;
+        case 0x55:
+        case 0x65:
+            return 14 + 14 * (((opcode & 0x0F00u) >> 8u) + 1);
+        default:
+            return 10;
+        }
+    }
+}
+
+void Chip8::seed(u64 value)
+{
+    rng.seed(value);
+}
+
+Fault Chip8::fault() const
+{
+    if (faults & (1u << (int)Fault::ILLEGAL_OPCODE))
+        return Fault::ILLEGAL_OPCODE;
+    if (faults & (1u << (int)Fault::STACK))
+        return Fault::STACK;
+    if (faults & (1u << (int)Fault::MEMORY))
+        return Fault::MEMORY;
+    return Fault::NONE;
+}
+
+void Chip8::clearFault()
+{
+    faults = 0;
+}
+
+// the registers hashed by stateHash(), keypad and opcode left out as they
+// don't decide what runs next
+#define HASH_FIELDS(FIELD)                                                        \
+    FIELD(pc) FIELD(index) FIELD(sp) FIELD(delay_timer) FIELD(sound_timer) FIELD(V) \
+    FIELD(stack) FIELD(waiting) FIELD(wait_reg) FIELD(flags) FIELD(plane)          \
+    FIELD(pattern) FIELD(pitch) FIELD(pattern_loaded) FIELD(vblank) FIELD(rng)    \
+    FIELD(display.width) FIELD(display.height)
+
+// a few dozen bytes, packed then mixed 8 bytes at a time
+u64 Chip8::registersHash() const
+{
+#define FIELD_SIZE(field) +sizeof(field)
+    u8 packed[(0 HASH_FIELDS(FIELD_SIZE) + 7) & ~7] = {0};
+#undef FIELD_SIZE
+    u8 *out = packed;
+#define PACK_FIELD(field)                 \
+    memcpy(out, &field, sizeof(field));   \
+    out += sizeof(field);
+    HASH_FIELDS(PACK_FIELD)
+#undef PACK_FIELD
+
+    u64 hash = 0;
+    for (size_t i = 0; i < sizeof(packed); i += 8)
+    {
+        u64 chunk;
+        memcpy(&chunk, packed + i, 8);
+        hash = hashMix(hash ^ chunk) + i;
+    }
+    return hash;
+}
+
+u64 Chip8::displayHash() const
+{
+    u64 hash = 0;
+    for (u32 p = 0; p < PLANES_COUNT; p++)
+    {
+        for (u32 y = 0; y < HIRES_HEIGHT; y++)
+        {
+            for (u32 w = 0; w < ROW_WORDS; w++)
+                hash ^= displayKey((p * HIRES_HEIGHT + y) * ROW_WORDS + w, display.planes[p][y][w]);
+        }
+    }
+    return hash;
+}
+
+u8 Chip8::reg(u8 x) const
+{
+    return V[x & 0xFu];
+}
+
+Registers Chip8::registers() const
+{
+    Registers registers = {pc, index, opcode, sp, delay_timer, sound_timer, {0}};
+    memcpy(registers.V, V, sizeof(V));
+    return registers;
+}
+
+void Chip8::setBreakpoint(u32 address)
+{
+    breakpoint = address;
+}
+
+// the registers, in the order they are laid out in a state, memcpy'ed as is
+#define STATE_FIELDS(FIELD)                                                       \
+    FIELD(pc) FIELD(index) FIELD(opcode) FIELD(sp) FIELD(delay_timer)             \
+    FIELD(sound_timer) FIELD(V) FIELD(stack) FIELD(waiting) FIELD(wait_reg)       \
+    FIELD(flags) FIELD(plane) FIELD(pattern) FIELD(pitch) FIELD(pattern_loaded)   \
+    FIELD(vblank) FIELD(rng) FIELD(keypad) FIELD(display.planes)                  \
+    FIELD(display.width) FIELD(display.height) FIELD(memory_hash) FIELD(display_hash) \
+    FIELD(memory_stale) FIELD(display_stale)
+
+size_t Chip8::registersSize() const
+{
+#define FIELD_SIZE(field) +sizeof(field)
+    return 0 STATE_FIELDS(FIELD_SIZE);
+#undef FIELD_SIZE
+}
+
+void Chip8::saveRegisters(u8 *&out) const
+{
+#define SAVE_FIELD(field)                 \
+    memcpy(out, &field, sizeof(field));   \
+    out += sizeof(field);
+    STATE_FIELDS(SAVE_FIELD)
+#undef SAVE_FIELD
+}
+
+void Chip8::loadRegisters(const u8 *&in)
+{
+#define LOAD_FIELD(field)                 \
+    memcpy(&field, in, sizeof(field));    \
+    in += sizeof(field);
+    STATE_FIELDS(LOAD_FIELD)
+#undef LOAD_FIELD
+}
+
+// load ROM into memory starting from PROGRAM_START
+bool Chip8::loadROM(const u8 *rom, size_t size)
+{
+    size_t capacity;
+    u8 *destination = program(capacity);
+    if (size > capacity)
+    {
+        // no enough space for the program
+        return false;
+    }
+    memcpy(destination, rom, size);
+    memory_stale = true;
+    return true;
+}
+
+// timers run at TIMER_HZ independently of the instructions,
+// so they keep counting down while FX0A is waiting
+void Chip8::updateTimers()
+{
+    // a new frame starts, DXYN can draw again
+    vblank = false;
+
+    if (delay_timer)
+    {
+        delay_timer--;
+    }
+    if (sound_timer)
+    {
+        sound_timer--;
+    }
+}
+
+u8 Chip8::soundTimer() const
+{
+    return sound_timer;
+}
+
+// the host can stop stepping and block on input while this is true
+bool Chip8::isWaiting() const
+{
+    return waiting;
+}
+
+const u8 *Chip8::audioPattern() const
+{
+    return pattern_loaded ? pattern : nullptr;
+}
+
+u8 Chip8::audioPitch() const
+{
+    return pitch;
+}
+
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::initFonts()
+{
+    for (int i = 0; i < FONTS_COUNT; i++)
+    {
+        memory[FONTS_START + i] = font_sprite[i];
+    }
+    for (int i = 0; i < BIG_FONTS_COUNT; i++)
+    {
+        memory[BIG_FONTS_START + i] = big_font_sprite[i];
+    }
+}
+
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::skipNext()
+{
+    // F000 NNNN is the only 4 bytes instruction
+    if constexpr (Traits::xochip)
+    {
+        if (at(pc) == 0xF0u && at(pc + 1u) == 0x00u)
+        {
+            pc += 2;
+        }
+    }
+    pc += 2;
+}
+
+void Chip8::setResolution(u8 width, u8 height)
+{
+    display.width = width;
+    display.height = height;
+    memset(display.planes, 0, sizeof(display.planes));
+    display_stale = true;
+}
+//----------------------------------------------------------------------------------
+
+// extract ?(NNN)
+u16 Chip8::address()
+{
+    return (opcode & 0x0FFFu);
+}
+
+// extract ??(NN)
+u8 Chip8::value()
+{
+    return (opcode & 0x00FFu);
+}
+
+// extract ?(X)??
+u8 Chip8::regx()
+{
+    return (opcode & 0x0F00u) >> 8u;
+}
+
+// extract ??(Y)?
+u8 Chip8::regy()
+{
+    return (opcode & 0x00F0u) >> 4u;
+}
+//----------------------------------------------------------------------------------
+
+// left most bit
+u8 Chip8::msb(u8 reg)
+{
+    return (reg & 0x80u) >> 7u;
+}
+
+// right most bit
+u8 Chip8::lsb(u8 reg)
+{
+    return (reg & 0x1u);
+}
+/**********************************************************************************/
+
+// clear display, only the selected planes on XO-CHIP
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_00E0()
+{
+    for (int p = 0; p < PLANES_COUNT; p++)
+    {
+        if (plane & (1u << p))
+            memset(display.planes[p], 0, sizeof(display.planes[p]));
+    }
+    display_stale = true;
+}
+
+// scroll down N rows, moves whole rows at once
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_00CN()
+{
+    u8 n = (opcode & 0x000Fu);
+    u8 height = display.height;
+
+    for (int p = 0; p < PLANES_COUNT; p++)
+    {
+        if (!(plane & (1u << p)))
+            continue;
+
+        u64 (*rows)[ROW_WORDS] = display.planes[p];
+        memmove(rows[n], rows[0], (height - n) * sizeof(rows[0]));
+        memset(rows[0], 0, n * sizeof(rows[0]));
+    }
+    display_stale = true;
+}
+
+// scroll right 4 pixels, each row is shifted as one 128-bit word
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_00FB()
+{
+    // in lores the second word must stay empty
+    u64 lo_mask = (display.width == HIRES_WIDTH) ? ~0ull : 0ull;
+
+    for (int p = 0; p < PLANES_COUNT; p++)
+    {
+        if (!(plane & (1u << p)))
+            continue;
+
+        for (int y = 0; y < display.height; y++)
+        {
+            u64 *row = display.planes[p][y];
+            row[1] = ((row[1] >> 4) | (row[0] << 60)) & lo_mask;
+            row[0] >>= 4;
+        }
+    }
+    display_stale = true;
+}
+
+// scroll left 4 pixels
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_00FC()
+{
+    for (int p = 0; p < PLANES_COUNT; p++)
+    {
+        if (!(plane & (1u << p)))
+            continue;
+
+        for (int y = 0; y < display.height; y++)
+        {
+            u64 *row = display.planes[p][y];
+            row[0] = (row[0] << 4) | (row[1] >> 60);
+            row[1] <<= 4;
+        }
+    }
+    display_stale = true;
+}
+
+// lores 64x32
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_00FE()
+{
+    setResolution(DISPLAY_WIDHT, DISPLAY_HEIGHT);
+}
+
+// hires 128x64
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_00FF()
+{
+    setResolution(HIRES_WIDTH, HIRES_HEIGHT);
+}
+
+// uncoditional jump
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_1NNN()
+{
+    pc = address();
+}
+
+// jump to subroutine
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_2NNN()
+{
+    // push to stack and jump, a 17th call wraps around the stack and faults
+    u8 overflow = (u8)(sp >= STACK_SIZE);
+    trap |= overflow << (int)Fault::STACK;
+    faults |= trap;
+    stack[sp & (STACK_SIZE - 1)] = pc;
+    sp++;
+    pc = address();
+}
+
+// return from subroutine
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_00EE()
+{
+    // pop and return, an empty stack wraps around and faults
+    sp--;
+    u8 underflow = (u8)(sp >= STACK_SIZE);
+    trap |= underflow << (int)Fault::STACK;
+    faults |= trap;
+    pc = stack[sp & (STACK_SIZE - 1)];
+}
+
+// if (Vx == NN) pc+=2
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_3XNN()
+{
+    u8 x = regx();
+    u8 NN = value();
+
+    if (V[x] == NN)
+    {
+        skipNext();
+    }
+}
+
+// if (Vx != NN) pc+=2
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_4XNN()
+{
+    u8 x = regx();
+    u8 NN = value();
+
+    if (V[x] != NN)
+    {
+        skipNext();
+    }
+}
+
+// if (Vx == Vy) pc+=2
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_5XY0()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    if (V[x] == V[y])
+    {
+        skipNext();
+    }
+}
+
+// mem[i]=vx...mem[i+|x-y|]=vy, x > y stores them in reverse order
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_5XY2()
+{
+    u8 x = regx();
+    u8 y = regy();
+    int step = (x <= y) ? 1 : -1;
+
+    for (int i = 0, r = x; ; i++, r += step)
+    {
+        store(index + i, V[r]);
+        if (r == y)
+            break;
+    }
+}
+
+// vx=mem[i]...vy=mem[i+|x-y|]
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_5XY3()
+{
+    u8 x = regx();
+    u8 y = regy();
+    int step = (x <= y) ? 1 : -1;
+
+    for (int i = 0, r = x; ; i++, r += step)
+    {
+        V[r] = at(index + i);
+        if (r == y)
+            break;
+    }
+}
+
+// if (Vx != Vy) pc+=2
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_9XY0()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    if (V[x] != V[y])
+    {
+        skipNext();
+    }
+}
+
+// vx = NN
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_6XNN()
+{
+    u8 x = regx();
+    u8 NN = value();
+
+    V[x] = NN;
+}
+
+// vx += NN (Vf isn't affected)
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_7XNN()
+{
+    u8 x = regx();
+    u8 NN = value();
+
+    V[x] += NN;
+}
+
+// Vx = Vy
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY0()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    V[x] = V[y];
+}
+
+// Vx |= Vy
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY1()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    V[x] |= V[y];
+
+    // VIP: the logic ops clobber VF
+    if constexpr (Quirks::vf_reset)
+        V[0xF] = 0;
+}
+
+// Vx &= Vy
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY2()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    V[x] &= V[y];
+
+    // VIP: the logic ops clobber VF
+    if constexpr (Quirks::vf_reset)
+        V[0xF] = 0;
+}
+
+// Vx &= Vy
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY3()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    V[x] ^= V[y];
+
+    // VIP: the logic ops clobber VF
+    if constexpr (Quirks::vf_reset)
+        V[0xF] = 0;
+}
+
+// Vx += Vy, vf: affected
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY4()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    u16 sum = (V[x] + V[y]);
+
+    V[x] = (u8)(sum & 0xFFu);
+
+    if (sum > 0xFFu)
+    {
+        V[0xF] = 1;
+    }
+    else
+    {
+        V[0xF] = 0;
+    }
+}
+
+// Vx -= Vy, vf: affected
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY5()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    u8 old_val = V[x];
+
+    V[x] = V[x] - V[y];
+
+    if (old_val >= V[y])
+    {
+        V[0xF] = 1;
+    }
+    else
+    {
+        V[0xF] = 0;
+    }
+}
+
+// Vx >>= 1, vf: affected
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY6()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    // VIP shifts Vy, SUPER-CHIP shifts Vx in place
+    if constexpr (Quirks::shift_vy)
+        V[x] = V[y];
+    u8 old_val = V[x];
+
+    V[x] >>= 1;
+    V[0xF] = lsb(old_val);
+}
+
+// Vx = Vy - Vx, Vf: affected
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XY7()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    u8 old_val = V[y];
+
+    V[x] = V[y] - V[x];
+
+    if (old_val >= V[x])
+    {
+        V[0xF] = 1;
+    }
+    else
+    {
+        V[0xF] = 0;
+    }
+}
+
+// Vx <<= 1, vf: affected
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_8XYE()
+{
+    u8 x = regx();
+    u8 y = regy();
+
+    // VIP shifts Vy, SUPER-CHIP shifts Vx in place
+    if constexpr (Quirks::shift_vy)
+        V[x] = V[y];
+    u8 old_val = V[x];
+
+    V[x] <<= 1;
+    V[0xF] = msb(old_val);
+}
+
+// I = NNN
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_ANNN()
+{
+    index = address();
+}
+
+// I = NNNN, the operand is the word following the instruction
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_F000()
+{
+    index = (u16)(at(pc) << 8u) | at(pc + 1u);
+    pc += 2;
+}
+
+// unconditional jump to (V0 + NNN)
+// SUPER-CHIP reads it as BXNN: jump to (VX + XNN)
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_BNNN()
+{
+    if constexpr (Quirks::jump_vx)
+        pc = address() + V[regx()];
+    else
+        pc = address() + V[0];
+}
+
+// Vx = random byte & NN, from the instance's own generator
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_CXNN()
+{
+    u8 x = regx();
+    u8 NN = value();
+
+    V[x] = rng.byte() & NN;
+}
+
+// draws N bytes read starting from I->I+N
+// DXY0 draws a 16x16 sprite, 2 bytes per row
+// on XO-CHIP every selected plane gets its own sprite, stored one after the other
+// vf: affected, I: not affected
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_DXYN()
+{
+    u8 n = (opcode & 0x000Fu);
+    u8 width = display.width;
+    u8 height = display.height;
+
+    // V[x], V[y] top left corner, the start always wraps,
+    // the rest of the sprite is clipped or wraps depending on the quirk
+    u8 x = V[regx()] % width;
+    u8 y = V[regy()] % height;
+
+    // DXY0 is 16x16 from SUPER-CHIP on, nothing on CHIP-8
+    u8 rows = n;
+    u8 row_bytes = 1;
+    if constexpr (Traits::schip)
+    {
+        if (n == 0)
+        {
+            rows = 16;
+            row_bytes = 2;
+        }
+    }
+
+    // bits past the first word are outside of the lores screen
+    u64 lo_mask = (width == HIRES_WIDTH) ? ~0ull : 0ull;
+
+    u64 collision = 0;
+    u32 sprite_addr = index;
+    for (int p = 0; p < PLANES_COUNT; p++)
+    {
+        if (!(plane & (1u << p)))
+            continue;
+
+        for (int i = 0; i < rows; i++)
+        {
+            // clipping
+            u8 row_y = y + i;
+            if constexpr (Quirks::clipping)
+            {
+                if (row_y >= height)
+                    break;
+            }
+            else
+            {
+                row_y %= height;
+            }
+
+            // sprite row left aligned in a 64-bit word (pixel 0 is the msb)
+            u64 sprite = (u64)at(sprite_addr + i * row_bytes) << 56;
+            if (row_bytes == 2)
+                sprite |= (u64)at(sprite_addr + i * row_bytes + 1) << 48;
+
+            // shift it to column x across the two words of the row,
+            // bits falling off the right edge are clipped
+            u64 hi, lo;
+            if (x < 64)
+            {
+                hi = sprite >> x;
+                lo = x ? (sprite << (64 - x)) : 0;
+            }
+            else
+            {
+                hi = 0;
+                lo = sprite >> (x - 64);
+            }
+
+            // or rotated back to the left edge
+            if constexpr (!Quirks::clipping)
+            {
+                if (width == HIRES_WIDTH && x > 64)
+                    hi |= sprite << (128 - x);
+                else if (width != HIRES_WIDTH)
+                    hi |= lo;
+            }
+            lo &= lo_mask;
+
+            // All the pixels that are “on” in the sprite will flip the pixels on the screen
+            // on -> off: flag
+            u64 *row = display.planes[p][row_y];
+            u32 slot = ((u32)p * HIRES_HEIGHT + row_y) * ROW_WORDS;
+            display_hash ^= displayKey(slot, row[0]) ^ displayKey(slot, row[0] ^ hi) ^
+                            displayKey(slot + 1, row[1]) ^ displayKey(slot + 1, row[1] ^ lo);
+            collision |= (row[0] & hi) | (row[1] & lo);
+            row[0] ^= hi;
+            row[1] ^= lo;
+        }
+        sprite_addr += rows * row_bytes;
+    }
+
+    V[0xF] = collision ? 1 : 0;
+
+    if constexpr (Quirks::display_wait)
+        vblank = true;
+}
+
+// if (key() == Vx) pc+=2, only the low nibble picks the key
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_EX9E()
+{
+    u8 x = regx();
+
+    if (keypad[V[x] & 0xFu])
+    {
+        skipNext();
+    }
+}
+
+// if (key() != Vx) pc+=2, only the low nibble picks the key
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_EXA1()
+{
+    u8 x = regx();
+
+    if (!keypad[V[x] & 0xFu])
+    {
+        skipNext();
+    }
+}
+
+// Vx = get_key()
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX0A()
+{
+    // enter the waiting state instead of re-executing the instruction,
+    // clock() won't fetch anything untill a key is pressed
+    wait_reg = regx();
+    waiting = true;
+    resolveWait();
+}
+
+// stores the first pressed key into the FX0A register and leaves the waiting state
+bool Chip8::resolveWait()
+{
+    for (int i = 0; i < KEYPAD_SIZE; i++)
+    {
+        if (keypad[i])
+        {
+            V[wait_reg] = (u8)i;
+            waiting = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Vx = delay_timer
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX07()
+{
+    u8 x = regx();
+
+    V[x] = delay_timer;
+}
+
+// delay_timer = Vx
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX15()
+{
+    u8 x = regx();
+
+    delay_timer = V[x];
+}
+
+// sound_timer = Vx
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX18()
+{
+    u8 x = regx();
+
+    sound_timer = V[x];
+}
+
+// I = I + Vx         :Vf=1 if there is overflow
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX1E()
+{
+    u8 x = regx();
+
+    u32 sum = index + V[x];
+    index = (u16)sum;
+
+    if (sum >= Traits::memory_size)
+    {
+        V[0xF] = 1;
+    }
+    else
+    {
+        V[0xF] = 0;
+    }
+}
+
+// I = sprite_addr[Vx], reads font, digits above F use the low nibble like FX30
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX29()
+{
+    u8 x = regx();
+
+    index = FONTS_START + 5 * (V[x] & 0xFu);
+}
+
+// I = big_sprite_addr[Vx], reads the SUPER-CHIP 8x10 font
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX30()
+{
+    u8 x = regx();
+
+    index = BIG_FONTS_START + 10 * (V[x] & 0xFu);
+}
+
+// if vx = 159: mem[i+0] = 1, mem[i+1] = 5, mem[i+2] = 9
+// BCD, Binary coded decimal
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX33()
+{
+    u8 x = regx();
+    int num = (int)V[x];
+    store(index + 2u, (u8)(num % 10));
+    num /= 10;
+
+    store(index + 1u, (u8)(num % 10));
+    num /= 10;
+
+    store(index, (u8)(num % 10));
+}
+
+// mem[i]=v0, mem[i+1]=v1...mem[i+x]=vx. I: doesn't change
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX55()
+{
+    u8 x = regx();
+
+    for (int i = 0; i <= x; i++)
+    {
+        store(index + i, V[i]);
+    }
+    if constexpr (Quirks::memory_increment)
+        index += x + 1;
+}
+
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX65()
+{
+    u8 x = regx();
+
+    for (int i = 0; i <= x; i++)
+    {
+        V[i] = at(index + i);
+    }
+    if constexpr (Quirks::memory_increment)
+        index += x + 1;
+}
+
+// flags[0]=v0...flags[x]=vx
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX75()
+{
+    u8 x = regx() % FLAGS_COUNT;
+
+    for (int i = 0; i <= x; i++)
+    {
+        flags[i] = V[i];
+    }
+}
+
+// v0=flags[0]...vx=flags[x]
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX85()
+{
+    u8 x = regx() % FLAGS_COUNT;
+
+    for (int i = 0; i <= x; i++)
+    {
+        V[i] = flags[i];
+    }
+}
+
+// plane = N, selects the planes drawn/cleared/scrolled
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FN01()
+{
+    plane = regx() & 0x3u;
+}
+
+// pattern = mem[i:i+15]
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_F002()
+{
+    for (int i = 0; i < PATTERN_SIZE; i++)
+    {
+        pattern[i] = at(index + i);
+    }
+    pattern_loaded = true;
+}
+
+// pitch = Vx, playback rate is 4000 * 2^((Vx - 64) / 48) bits per second
+template <typename Traits, typename Quirks>
+void Chip8Core<Traits, Quirks>::op_FX3A()
+{
+    u8 x = regx();
+
+    pitch = V[x];
+}
+
+template <typename Traits, typename Quirks>
+FORCE_INLINE void Chip8Core<Traits, Quirks>::group_0(u8 last_two, const char *&executed)
+{
+    // SUPER-CHIP display instructions
+    if constexpr (Traits::schip)
+    {
+        // 00CN carries its operand in the last nibble
+        if ((last_two & 0xF0u) == 0xC0u)
+        {
+            executed = "00CN";
+            op_00CN();
+            return;
+        }
+
+        switch (last_two)
+        {
+        case 0xFB:
+            executed = "00FB";
+            op_00FB();
+            return;
+        case 0xFC:
+            executed = "00FC";
+            op_00FC();
+            return;
+        case 0xFE:
+            executed = "00FE";
+            op_00FE();
+            return;
+        case 0xFF:
+            executed = "00FF";
+            op_00FF();
+            return;
+        default:
+            break;
+        }
+    }
+
+    switch (last_two)
+    {
+    case 0xE0:
+        executed = "00E0";
+        op_00E0();
+        break;
+    case 0xEE:
+        executed = "00EE";
+        op_00EE();
+        break;
+    default:
+        illegalOpcode();
+        break;
+    }
+}
+
+template <typename Traits, typename Quirks>
+FORCE_INLINE void Chip8Core<Traits, Quirks>::group_5(u8 fourth_nibble, const char *&executed)
+{
+    // XO-CHIP register ranges
+    if constexpr (Traits::xochip)
+    {
+        switch (fourth_nibble)
+        {
+        case 0x2:
+            executed = "5XY2";
+            op_5XY2();
+            return;
+        case 0x3:
+            executed = "5XY3";
+            op_5XY3();
+            return;
+        default:
+            break;
+        }
+    }
+
+    switch (fourth_nibble)
+    {
+    case 0x0:
+        executed = "5XY0";
+        op_5XY0();
+        break;
+    default:
+        illegalOpcode();
+        break;
+    }
+}
+
+template <typename Traits, typename Quirks>
+FORCE_INLINE void Chip8Core<Traits, Quirks>::group_8(u8 fourth_nibble, const char *&executed)
+{
+    switch (fourth_nibble)
+    {
+    case 0x0:
+        executed = "8XY0";
+        op_8XY0();
+        break;
+    case 0x1:
+        executed = "8XY1";
+        op_8XY1();
+        break;
+    case 0x2:
+        executed = "8XY2";
+        op_8XY2();
+        break;
+    case 0x3:
+        executed = "8XY3";
+        op_8XY3();
+        break;
+    case 0x4:
+        executed = "8XY4";
+        op_8XY4();
+        break;
+    case 0x5:
+        executed = "8XY5";
+        op_8XY5();
+        break;
+    case 0x6:
+        executed = "8XY6";
+        op_8XY6();
+        break;
+    case 0x7:
+        executed = "8XY7";
+        op_8XY7();
+        break;
+    case 0xE:
+        executed = "8XYE";
+        op_8XYE();
+        break;
+    default:
+        illegalOpcode();
+        break;
+    }
+}
+
+template <typename Traits, typename Quirks>
+FORCE_INLINE void Chip8Core<Traits, Quirks>::group_E(u8 fourth_nibble, const char *&executed)
+{
+    switch (fourth_nibble)
+    {
+    case 0xE:
+        executed = "EX9E";
+        op_EX9E();
+        break;
+    case 0x1:
+        executed = "EXA1";
+        op_EXA1();
+        break;
+    default:
+        illegalOpcode();
+        break;
+    }
+}
+
+template <typename Traits, typename Quirks>
+FORCE_INLINE void Chip8Core<Traits, Quirks>::group_F(u8 last_two, const char *&executed)
+{
+    // SUPER-CHIP big font and flags
+    if constexpr (Traits::schip)
+    {
+        switch (last_two)
+        {
+        case 0x30:
+            executed = "FX30";
+            op_FX30();
+            return;
+        case 0x75:
+            executed = "FX75";
+            op_FX75();
+            return;
+        case 0x85:
+            executed = "FX85";
+            op_FX85();
+            return;
+        default:
+            break;
+        }
+    }
+
+    // XO-CHIP long index, planes and audio, F000 and F002 only exist with x = 0
+    if constexpr (Traits::xochip)
+    {
+        switch (last_two)
+        {
+        case 0x00:
+            if (regx() != 0)
+                break;
+            executed = "F000";
+            op_F000();
+            return;
+        case 0x01:
+            executed = "FN01";
+            op_FN01();
+            return;
+        case 0x02:
+            if (regx() != 0)
+                break;
+            executed = "F002";
+            op_F002();
+            return;
+        case 0x3A:
+            executed = "FX3A";
+            op_FX3A();
+            return;
+        default:
+            break;
+        }
+    }
+
+    switch (last_two)
+    {
+    case 0x07:
+        executed = "FX07";
+        op_FX07();
+        break;
+    case 0x0A:
+        executed = "FX0A";
+        op_FX0A();
+        break;
+    case 0x15:
+        executed = "FX15";
+        op_FX15();
+        break;
+    case 0x18:
+        executed = "FX18";
+        op_FX18();
+        break;
+    case 0x1E:
+        executed = "FX1E";
+        op_FX1E();
+        break;
+    case 0x29:
+        executed = "FX29";
+        op_FX29();
+        break;
+    case 0x33:
+        executed = "FX33";
+        op_FX33();
+        break;
+    case 0x55:
+        executed = "FX55";
+        op_FX55();
+        break;
+    case 0x65:
+        executed = "FX65";
+        op_FX65();
+        break;
+    default:
+        illegalOpcode();
+        break;
+    }
+}
+
+// the instantiations createChip8() can pick from
+template class Chip8Core<Chip8Traits, DefaultQuirks>;
+template class Chip8Core<Chip8Traits, VipQuirks>;
+template class Chip8Core<Chip8Traits, SChipQuirks>;
+template class Chip8Core<Chip8Traits, XOChipQuirks>;
+template class Chip8Core<Chip8Traits, VipTimedQuirks>;
+template class Chip8Core<SChipTraits, DefaultQuirks>;
+template class Chip8Core<SChipTraits, VipQuirks>;
+template class Chip8Core<SChipTraits, SChipQuirks>;
+template class Chip8Core<SChipTraits, XOChipQuirks>;
+template class Chip8Core<SChipTraits, VipTimedQuirks>;
+template class Chip8Core<XOChipTraits, DefaultQuirks>;
+template class Chip8Core<XOChipTraits, VipQuirks>;
+template class Chip8Core<XOChipTraits, SChipQuirks>;
+template class Chip8Core<XOChipTraits, XOChipQuirks>;
+template class Chip8Core<XOChipTraits, VipTimedQuirks>;
+
+template <typename Traits>
+static std::unique_ptr<Chip8> createCore(QuirkProfile quirks)
+{
+    switch (quirks)
+    {
+    case QuirkProfile::VIP:
+        return std::make_unique<Chip8Core<Traits, VipQuirks>>();
+    case QuirkProfile::SCHIP:
+        return std::make_unique<Chip8Core<Traits, SChipQuirks>>();
+    case QuirkProfile::XOCHIP:
+        return std::make_unique<Chip8Core<Traits, XOChipQuirks>>();
+    case QuirkProfile::VIP_TIMED:
+        return std::make_unique<Chip8Core<Traits, VipTimedQuirks>>();
+    case QuirkProfile::DEFAULT:
+    default:
+        return std::make_unique<Chip8Core<Traits, DefaultQuirks>>();
+    }
+}
+
+std::unique_ptr<Chip8> createChip8(Variant variant, QuirkProfile quirks)
+{
+    switch (variant)
+    {
+    case Variant::SCHIP:
+        return createCore<SChipTraits>(quirks);
+    case Variant::XOCHIP:
+        return createCore<XOChipTraits>(quirks);
+    case Variant::CHIP8:
+    default:
+        return createCore<Chip8Traits>(quirks);
+    }
+}
+
+std::unique_ptr<Chip8> createChip8(Variant variant)
+{
+    return createChip8(variant, defaultQuirks(variant));
+}
+
+QuirkProfile defaultQuirks(Variant variant)
+{
+    switch (variant)
+    {
+    case Variant::SCHIP:
+        return QuirkProfile::SCHIP;
+    case Variant::XOCHIP:
+        return QuirkProfile::XOCHIP;
+    case Variant::CHIP8:
+    default:
+        return QuirkProfile::DEFAULT;
+    }
 }
\ No newline at end of file
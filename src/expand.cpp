@@ -0,0 +1,359 @@
+#include "../include/expand.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EXPAND_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// every kernel writes one display row already widened scale times,
+// expandFrame()/expandIndices() copy it to the scale - 1 rows below
+typedef void (*PackedRow)(const u64 *, const u64 *, int, const u32 *, int, u32 *);
+typedef void (*IndexRow)(const u8 *, int, const u32 *, int, u32 *);
+
+// scalar
+
+// spread[b] has byte j set to 1 if bit (7 - j) of b is set, so the 8 pixels
+// of a display byte become 8 palette indices packed in one word (msb first)
+struct SpreadTable
+{
+    u64 spread[256];
+
+    SpreadTable()
+    {
+        for (int b = 0; b < 256; b++)
+        {
+            spread[b] = 0;
+            for (int j = 0; j < 8; j++)
+            {
+                if (b & (0x80u >> j))
+                    spread[b] |= 1ull << (56 - 8 * j);
+            }
+        }
+    }
+};
+
+static const SpreadTable table;
+
+static inline u32 *storeScaled(u32 color, int scale, u32 *out)
+{
+    for (int i = 0; i < scale; i++)
+        *out++ = color;
+    return out;
+}
+
+static void packedRowScalar(const u64 *p0, const u64 *p1, int width, const u32 *palette, int scale, u32 *out)
+{
+    for (int w = 0; w < width / 64; w++)
+    {
+        // most of the screen is background, 64 pixels at once
+        if (!(p0[w] | p1[w]))
+        {
+            out = std::fill_n(out, 64 * scale, palette[0]);
+            continue;
+        }
+
+        for (int k = 56; k >= 0; k -= 8)
+        {
+            // both planes' bits combined into 8 indices in parallel
+            u64 indices = table.spread[(p0[w] >> k) & 0xFFu] | (table.spread[(p1[w] >> k) & 0xFFu] << 1);
+            for (int j = 56; j >= 0; j -= 8)
+                out = storeScaled(palette[(indices >> j) & 0x3u], scale, out);
+        }
+    }
+}
+
+static void indexRowScalar(const u8 *in, int width, const u32 *palette, int scale, u32 *out)
+{
+    for (int x = 0; x < width; x++)
+        out = storeScaled(palette[in[x] & 0x3u], scale, out);
+}
+
+#ifdef EXPAND_X86
+
+// SSE2, 4 pixels per register
+
+// (mask & a) | (~mask & b)
+TARGET_SSE2 static inline __m128i select128(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// colors of the 4 pixels whose index bits are set in bit0/bit1 lanes
+TARGET_SSE2 static inline __m128i colors128(__m128i bit0, __m128i bit1, const __m128i *palette)
+{
+    return select128(bit1, select128(bit0, palette[3], palette[2]), select128(bit0, palette[1], palette[0]));
+}
+
+TARGET_SSE2 static inline u32 *storeScaled128(__m128i colors, int scale, u32 *out)
+{
+    if (scale == 1)
+    {
+        _mm_storeu_si128((__m128i *)out, colors);
+        return out + 4;
+    }
+    if (scale == 2)
+    {
+        _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi32(colors, colors));
+        _mm_storeu_si128((__m128i *)(out + 4), _mm_unpackhi_epi32(colors, colors));
+        return out + 8;
+    }
+    if (scale % 4 == 0)
+    {
+        // every pixel broadcast to whole registers
+        __m128i spread[4] = {_mm_shuffle_epi32(colors, 0x00), _mm_shuffle_epi32(colors, 0x55),
+                             _mm_shuffle_epi32(colors, 0xAA), _mm_shuffle_epi32(colors, 0xFF)};
+        for (int p = 0; p < 4; p++)
+        {
+            for (int i = 0; i < scale; i += 4, out += 4)
+                _mm_storeu_si128((__m128i *)out, spread[p]);
+        }
+        return out;
+    }
+
+    alignas(16) u32 lanes[4];
+    _mm_store_si128((__m128i *)lanes, colors);
+    for (int p = 0; p < 4; p++)
+        out = storeScaled(lanes[p], scale, out);
+    return out;
+}
+
+TARGET_SSE2 static void packedRowSSE2(const u64 *p0, const u64 *p1, int width, const u32 *palette, int scale, u32 *out)
+{
+    const __m128i colors[4] = {_mm_set1_epi32((int)palette[0]), _mm_set1_epi32((int)palette[1]),
+                               _mm_set1_epi32((int)palette[2]), _mm_set1_epi32((int)palette[3])};
+    const __m128i high = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+    const __m128i low = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+
+    for (int w = 0; w < width / 64; w++)
+    {
+        if (!(p0[w] | p1[w]))
+        {
+            out = std::fill_n(out, 64 * scale, palette[0]);
+            continue;
+        }
+
+        for (int k = 56; k >= 0; k -= 8)
+        {
+            __m128i b0 = _mm_set1_epi32((int)((p0[w] >> k) & 0xFFu));
+            __m128i b1 = _mm_set1_epi32((int)((p1[w] >> k) & 0xFFu));
+
+            // a lane is all ones where its pixel's bit is set
+            out = storeScaled128(colors128(_mm_cmpeq_epi32(_mm_and_si128(b0, high), high),
+                                           _mm_cmpeq_epi32(_mm_and_si128(b1, high), high), colors), scale, out);
+            out = storeScaled128(colors128(_mm_cmpeq_epi32(_mm_and_si128(b0, low), low),
+                                           _mm_cmpeq_epi32(_mm_and_si128(b1, low), low), colors), scale, out);
+        }
+    }
+}
+
+TARGET_SSE2 static void indexRowSSE2(const u8 *in, int width, const u32 *palette, int scale, u32 *out)
+{
+    const __m128i colors[4] = {_mm_set1_epi32((int)palette[0]), _mm_set1_epi32((int)palette[1]),
+                               _mm_set1_epi32((int)palette[2]), _mm_set1_epi32((int)palette[3])};
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int x = 0; x < width; x += 8)
+    {
+        // 8 bytes zero extended to two registers of 4 indices
+        __m128i bytes = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(in + x)), zero);
+        __m128i halves[2] = {_mm_unpacklo_epi16(bytes, zero), _mm_unpackhi_epi16(bytes, zero)};
+        for (int h = 0; h < 2; h++)
+        {
+            __m128i bit0 = _mm_cmpeq_epi32(_mm_and_si128(halves[h], one), one);
+            __m128i bit1 = _mm_cmpeq_epi32(_mm_and_si128(halves[h], two), two);
+            out = storeScaled128(colors128(bit0, bit1, colors), scale, out);
+        }
+    }
+}
+
+// AVX2, 8 pixels per register, the palette is a lookup through a permute
+
+// output lane j of the k-th register holds pixel (8k + j) / scale, so any
+// scale is scale permutes of the same 8 colors
+struct ScaleTable
+{
+    alignas(32) int lanes[MAX_SCALE + 1][MAX_SCALE][8];
+
+    ScaleTable()
+    {
+        for (int scale = 1; scale <= MAX_SCALE; scale++)
+        {
+            for (int k = 0; k < scale; k++)
+            {
+                for (int j = 0; j < 8; j++)
+                    lanes[scale][k][j] = (8 * k + j) / scale;
+            }
+        }
+    }
+};
+
+static const ScaleTable scales;
+
+TARGET_AVX2 static inline u32 *storeScaled256(__m256i colors, int scale, u32 *out)
+{
+    if (scale == 1)
+    {
+        _mm256_storeu_si256((__m256i *)out, colors);
+        return out + 8;
+    }
+    for (int k = 0; k < scale; k++, out += 8)
+    {
+        __m256i lanes = _mm256_load_si256((const __m256i *)scales.lanes[scale][k]);
+        _mm256_storeu_si256((__m256i *)out, _mm256_permutevar8x32_epi32(colors, lanes));
+    }
+    return out;
+}
+
+TARGET_AVX2 static void packedRowAVX2(const u64 *p0, const u64 *p1, int width, const u32 *palette, int scale, u32 *out)
+{
+    const __m256i colors = _mm256_setr_epi32((int)palette[0], (int)palette[1], (int)palette[2], (int)palette[3],
+                                             (int)palette[0], (int)palette[1], (int)palette[2], (int)palette[3]);
+
+    // with both bytes in one lane (plane 1 in bits 8-15) lane j shifts its
+    // plane 0 bit down to bit 0 and its plane 1 bit down to bit 1
+    const __m256i shift0 = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i shift1 = _mm256_setr_epi32(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+
+    for (int w = 0; w < width / 64; w++)
+    {
+        if (!(p0[w] | p1[w]))
+        {
+            out = std::fill_n(out, 64 * scale, palette[0]);
+            continue;
+        }
+
+        for (int k = 56; k >= 0; k -= 8)
+        {
+            __m256i bytes = _mm256_set1_epi32((int)(((p0[w] >> k) & 0xFFu) | (((p1[w] >> k) & 0xFFu) << 8)));
+            __m256i index = _mm256_or_si256(_mm256_and_si256(_mm256_srlv_epi32(bytes, shift0), one),
+                                            _mm256_and_si256(_mm256_srlv_epi32(bytes, shift1), two));
+            out = storeScaled256(_mm256_permutevar8x32_epi32(colors, index), scale, out);
+        }
+    }
+}
+
+TARGET_AVX2 static void indexRowAVX2(const u8 *in, int width, const u32 *palette, int scale, u32 *out)
+{
+    const __m256i colors = _mm256_setr_epi32((int)palette[0], (int)palette[1], (int)palette[2], (int)palette[3],
+                                             (int)palette[0], (int)palette[1], (int)palette[2], (int)palette[3]);
+
+    for (int x = 0; x < width; x += 8)
+    {
+        // the permute only looks at the low 3 bits, indices 0-3 need no masking
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in + x)));
+        out = storeScaled256(_mm256_permutevar8x32_epi32(colors, index), scale, out);
+    }
+}
+
+#endif
+
+struct Kernel
+{
+    PackedRow packed;
+    IndexRow index;
+};
+
+static Kernel kernelFor(ExpandKernel kernel)
+{
+#ifdef EXPAND_X86
+    if (kernel == ExpandKernel::AVX2)
+        return {packedRowAVX2, indexRowAVX2};
+    if (kernel == ExpandKernel::SSE2)
+        return {packedRowSSE2, indexRowSSE2};
+#endif
+    (void)kernel;
+    return {packedRowScalar, indexRowScalar};
+}
+
+static bool supported(ExpandKernel kernel)
+{
+#ifdef EXPAND_X86
+    // also runs from a static initializer, before the runtime's own cpu check
+    __builtin_cpu_init();
+    if (kernel == ExpandKernel::AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (kernel == ExpandKernel::SSE2)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return kernel == ExpandKernel::SCALAR;
+}
+
+static ExpandKernel bestKernel()
+{
+    if (supported(ExpandKernel::AVX2))
+        return ExpandKernel::AVX2;
+    if (supported(ExpandKernel::SSE2))
+        return ExpandKernel::SSE2;
+    return ExpandKernel::SCALAR;
+}
+
+// picked once at startup, setExpandKernel() is meant for benchmarks and
+// must not race with an expansion in progress
+static ExpandKernel current = bestKernel();
+static Kernel active = kernelFor(current);
+
+// the widened row is copied down instead of being expanded again
+static void repeatRow(u32 *row, int width, int scale, int pitch)
+{
+    for (int i = 1; i < scale; i++)
+        memcpy(row + i * pitch, row, width * scale * sizeof(u32));
+}
+
+void expandFrame(const Frame &frame, const u32 palette[4], int scale, u32 *out, int pitch)
+{
+    scale = std::min(std::max(scale, 1), MAX_SCALE);
+    for (int y = 0; y < frame.height; y++)
+    {
+        u32 *row = out + y * scale * pitch;
+        active.packed(frame.planes[0][y], frame.planes[1][y], frame.width, palette, scale, row);
+        repeatRow(row, frame.width, scale, pitch);
+    }
+}
+
+void expandIndices(const u8 *pixels, int width, int height, const u32 palette[4], int scale, u32 *out, int pitch)
+{
+    scale = std::min(std::max(scale, 1), MAX_SCALE);
+    for (int y = 0; y < height; y++)
+    {
+        u32 *row = out + y * scale * pitch;
+        active.index(pixels + y * width, width, palette, scale, row);
+        repeatRow(row, width, scale, pitch);
+    }
+}
+
+ExpandKernel expandKernel()
+{
+    return current;
+}
+
+bool setExpandKernel(ExpandKernel kernel)
+{
+    if (!supported(kernel))
+    {
+        return false;
+    }
+    current = kernel;
+    active = kernelFor(kernel);
+    return true;
+}
+
+const char *expandKernelName(ExpandKernel kernel)
+{
+    switch (kernel)
+    {
+    case ExpandKernel::AVX2:
+        return "avx2";
+    case ExpandKernel::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "../include/frame_clock.h"
+#include <thread>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+FrameClock::FrameClock(u32 hz, u32 spin_us)
+    : period(std::chrono::nanoseconds(1000000000 / hz)), spin(std::chrono::microseconds(spin_us)),
+      timer(-1), frames(0), overruns(0), max_us(0)
+{
+    for (int i = 0; i < JITTER_BUCKETS; i++)
+        buckets[i] = 0;
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC, its time points are usable as timer deadlines
+    timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+#endif
+}
+
+void FrameClock::start()
+{
+    deadline = std::chrono::steady_clock::now() + period;
+}
+
+bool FrameClock::wait()
+{
+    auto target = deadline;
+    auto now = std::chrono::steady_clock::now();
+
+    // the frame's work ended late, nothing to sleep for. less than a period
+    // behind is caught up by the next frames, further behind the clock
+    // restarts from now instead of running a burst of frames
+    if (now >= target)
+    {
+        auto late = now - target;
+        record((u64)std::chrono::duration_cast<std::chrono::microseconds>(late).count(), 1);
+        deadline = (late > period) ? now + period : target + period;
+        return false;
+    }
+
+    // sleeps till spin before the deadline, then polls the clock
+    auto wake = target - spin;
+    if (wake > now)
+    {
+#ifdef __linux__
+        if (timer >= 0)
+        {
+            auto since_boot = std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count();
+            itimerspec spec = {};
+            spec.it_value.tv_sec = since_boot / 1000000000;
+            spec.it_value.tv_nsec = since_boot % 1000000000;
+            u64 expirations;
+            if (timerfd_settime(timer, TFD_TIMER_ABSTIME, &spec, nullptr) == 0)
+                (void)!read(timer, &expirations, sizeof(expirations));
+        }
+        else
+#endif
+        {
+            std::this_thread::sleep_until(wake);
+        }
+    }
+    while ((now = std::chrono::steady_clock::now()) < target)
+    {
+    }
+
+    record((u64)std::chrono::duration_cast<std::chrono::microseconds>(now - target).count(), 0);
+    deadline = target + period;
+    return true;
+}
+
+JitterStats FrameClock::stats() const
+{
+    JitterStats copy;
+    copy.frames = frames.load(std::memory_order_relaxed);
+    copy.overruns = overruns.load(std::memory_order_relaxed);
+    copy.max_us = max_us.load(std::memory_order_relaxed);
+    for (int i = 0; i < JITTER_BUCKETS; i++)
+        copy.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    return copy;
+}
+
+FrameClock::~FrameClock()
+{
+#ifdef __linux__
+    if (timer >= 0)
+        close(timer);
+#endif
+}
+
+// single writer, relaxed stores are enough for readers polling the counters
+void FrameClock::record(u64 late_us, u64 missed)
+{
+    int bucket = 0;
+    while (bucket < JITTER_BUCKETS - 1 && late_us >= (1ull << bucket))
+        bucket++;
+
+    buckets[bucket].store(buckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    frames.store(frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    overruns.store(overruns.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+    if (late_us > max_us.load(std::memory_order_relaxed))
+        max_us.store(late_us, std::memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "../include/mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : mapping(nullptr), length(0)
+{
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    view = nullptr;
+#endif
+}
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    view = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!view)
+    {
+        close();
+        return false;
+    }
+
+    mapping = (const u8 *)MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+    length = (size_t)file_size.QuadPart;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after closing the descriptor
+    void *address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+    {
+        return false;
+    }
+
+    mapping = (const u8 *)address;
+    length = (size_t)info.st_size;
+#endif
+
+    if (!mapping)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (view)
+        CloseHandle(view);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    view = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (mapping)
+        munmap((void *)mapping, length);
+#endif
+    mapping = nullptr;
+    length = 0;
+}
+
+const u8 *MappedFile::data() const
+{
+    return mapping;
+}
+
+size_t MappedFile::size() const
+{
+    return length;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "../include/movie.h"
+#include "../include/chip8.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+Movie::Movie() : header(nullptr), frame_count(0), keyframes(0)
+{
+}
+
+bool Movie::open(const char *path)
+{
+    close();
+    if (!file.open(path))
+        return false;
+
+    const Header *mapped = (const Header *)file.data();
+    if (file.size() < sizeof(Header) || mapped->magic != MOVIE_MAGIC || mapped->version != MOVIE_VERSION ||
+        mapped->state_size < sizeof(StateHeader) || mapped->keyframe_every == 0)
+    {
+        close();
+        return false;
+    }
+    header = mapped;
+
+    // complete chunks, then what the last one holds: its keyframe if it
+    // wasn't cut short and the keys written after it
+    size_t body = file.size() - sizeof(Header);
+    size_t rest = body % chunkSize();
+    keyframes = body / chunkSize();
+    frame_count = keyframes * header->keyframe_every;
+    if (rest >= header->state_size)
+    {
+        keyframes++;
+        frame_count += (rest - header->state_size) / sizeof(u16);
+    }
+
+    // every movie starts with the state it was recorded from
+    if (keyframes == 0)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Movie::close()
+{
+    file.close();
+    header = nullptr;
+    frame_count = 0;
+    keyframes = 0;
+}
+
+u64 Movie::frames() const
+{
+    return frame_count;
+}
+
+u16 Movie::keys(u64 frame) const
+{
+    if (frame >= frame_count)
+        return 0;
+    u16 keys;
+    memcpy(&keys, keyframe(frame / header->keyframe_every) + header->state_size +
+                      (frame % header->keyframe_every) * sizeof(u16), sizeof(u16));
+    return keys;
+}
+
+// from the save state header of the first keyframe
+Variant Movie::variant() const
+{
+    StateHeader state;
+    memcpy(&state, keyframe(0), sizeof(state));
+    return (Variant)state.variant;
+}
+
+QuirkProfile Movie::quirks() const
+{
+    StateHeader state;
+    memcpy(&state, keyframe(0), sizeof(state));
+    return (QuirkProfile)state.quirks;
+}
+
+u32 Movie::cyclesPerFrame() const
+{
+    return header->cycles_per_frame;
+}
+
+u64 Movie::seed() const
+{
+    return header->seed;
+}
+
+const u8 *Movie::digest() const
+{
+    return header->digest;
+}
+
+bool Movie::seek(Chip8 &chip8, u64 frame) const
+{
+    if (!header || frame > frame_count)
+        return false;
+
+    // the end of a movie may not have its keyframe yet, the previous one is used
+    u64 nearest = std::min(frame / header->keyframe_every, keyframes - 1);
+    if (!chip8.loadState(keyframe(nearest), header->state_size))
+        return false;
+    chip8.clearFault();
+    for (u64 i = nearest * header->keyframe_every; i < frame; i++)
+        step(chip8, keys(i), header->cycles_per_frame);
+    return true;
+}
+
+void Movie::step(Chip8 &chip8, u16 keys, u32 cycles_per_frame)
+{
+    for (int k = 0; k < KEYPAD_SIZE; k++)
+        chip8.keypad[k] = (keys >> k) & 1u;
+    chip8.runFrame((int)cycles_per_frame);
+    chip8.updateTimers();
+}
+
+size_t Movie::chunkSize() const
+{
+    return header->state_size + (size_t)header->keyframe_every * sizeof(u16);
+}
+
+const u8 *Movie::keyframe(u64 index) const
+{
+    return file.data() + sizeof(Header) + index * chunkSize();
+}
+
+MovieWriter::MovieWriter()
+    : out(nullptr), opened(false), frame_count(0), keyframe_every(MOVIE_KEYFRAME_EVERY), keyframed(false), stop(false)
+{
+}
+
+bool MovieWriter::open(const char *path, Chip8 &chip8, const u8 digest[SHA1_SIZE], u32 cycles_per_frame, u64 seed,
+                       u32 every)
+{
+    close();
+
+    Movie existing;
+    if (existing.open(path))
+    {
+        // a movie of this ROM and machine, recording resumes from its end
+        if (memcmp(existing.digest(), digest, SHA1_SIZE) != 0 || !existing.seek(chip8, existing.frames()))
+            return false;
+        frame_count = existing.frames();
+        keyframe_every = existing.header->keyframe_every;
+        u64 chunk = frame_count / keyframe_every;
+        keyframed = existing.keyframes > chunk;
+        size_t end = sizeof(Movie::Header) + chunk * existing.chunkSize();
+        if (keyframed)
+            end += existing.header->state_size + (frame_count % keyframe_every) * sizeof(u16);
+        existing.close();
+
+        // whatever a crash left past the last complete frame is dropped
+        out = fopen(path, "r+b");
+        if (!out)
+            return false;
+#ifdef _WIN32
+        bool truncated = _chsize_s(_fileno(out), (long long)end) == 0;
+#else
+        bool truncated = ftruncate(fileno(out), (off_t)end) == 0;
+#endif
+        if (!truncated || fseek(out, 0, SEEK_END) != 0)
+        {
+            fclose(out);
+            out = nullptr;
+            return false;
+        }
+    }
+    else
+    {
+        // anything else in the file is left alone
+        FILE *other = fopen(path, "rb");
+        if (other)
+        {
+            fclose(other);
+            return false;
+        }
+        if (every == 0)
+            return false;
+
+        out = fopen(path, "wb");
+        if (!out)
+            return false;
+        Movie::Header header;
+        memset(&header, 0, sizeof(header));
+        header.magic = MOVIE_MAGIC;
+        header.version = MOVIE_VERSION;
+        memcpy(header.digest, digest, SHA1_SIZE);
+        header.state_size = (u32)chip8.stateSize();
+        header.seed = seed;
+        header.cycles_per_frame = cycles_per_frame;
+        header.keyframe_every = every;
+        frame_count = 0;
+        keyframe_every = every;
+        if (fwrite(&header, sizeof(header), 1, out) != 1)
+        {
+            fclose(out);
+            out = nullptr;
+            return false;
+        }
+        stageKeyframe(chip8);
+    }
+
+    // the first keyframe goes out at once, a movie without it isn't one
+    opened = true;
+    stop = false;
+    worker = std::thread(&MovieWriter::writeLoop, this);
+    handOff();
+    return true;
+}
+
+void MovieWriter::record(const Chip8 &chip8, u16 keys)
+{
+    if (!opened)
+        return;
+    if (!keyframed)
+        stageKeyframe(chip8);
+    const u8 *bytes = (const u8 *)&keys;
+    staged.insert(staged.end(), bytes, bytes + sizeof(keys));
+    frame_count++;
+    keyframed = frame_count % keyframe_every != 0;
+    if (!keyframed)
+        handOff();
+}
+
+u64 MovieWriter::frames() const
+{
+    return frame_count;
+}
+
+bool MovieWriter::isOpen() const
+{
+    return opened;
+}
+
+void MovieWriter::close()
+{
+    if (!opened)
+        return;
+    handOff();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_one();
+    worker.join();
+    fclose(out);
+    out = nullptr;
+    opened = false;
+}
+
+MovieWriter::~MovieWriter()
+{
+    close();
+}
+
+void MovieWriter::stageKeyframe(const Chip8 &chip8)
+{
+    size_t end = staged.size();
+    staged.resize(end + chip8.stateSize());
+    chip8.saveState(staged.data() + end);
+    keyframed = true;
+}
+
+// the lock is only held to append, the writer swaps the buffer out
+void MovieWriter::handOff()
+{
+    if (staged.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.insert(pending.end(), staged.begin(), staged.end());
+    }
+    wake.notify_one();
+    staged.clear();
+}
+
+// flushed after every hand off, a reader mapping the file sees every chunk up to the last one
+void MovieWriter::writeLoop()
+{
+    std::vector<u8> chunk;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        wake.wait(lock, [this] { return !pending.empty() || stop; });
+        if (pending.empty())
+            break;
+        std::swap(chunk, pending);
+        lock.unlock();
+        fwrite(chunk.data(), 1, chunk.size(), out);
+        fflush(out);
+        chunk.clear();
+        lock.lock();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "../include/perf_counters.h"
+
+#include <cstring>
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+// type and config of each PerfCounter
+static const struct
+{
+    u32 type;
+    u64 config;
+} events[(int)PerfCounter::COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+static int openEvent(u32 type, u64 config)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// value, time enabled, time running
+static bool readEvent(int fd, u64 read_format[3])
+{
+    return fd >= 0 && read(fd, read_format, 3 * sizeof(u64)) == (ssize_t)(3 * sizeof(u64));
+}
+#endif
+
+PerfCounters::PerfCounters() : failure(0)
+{
+    for (int i = 0; i < (int)PerfCounter::COUNT; i++)
+    {
+        values[i] = enabled[i] = running[i] = 0;
+#ifdef __linux__
+        fds[i] = openEvent(events[i].type, events[i].config);
+        if (fds[i] < 0 && !failure)
+            failure = errno;
+#else
+        fds[i] = -1;
+        failure = -1;
+#endif
+    }
+}
+
+bool PerfCounters::available(PerfCounter counter) const
+{
+    return fds[(int)counter] >= 0;
+}
+
+bool PerfCounters::any() const
+{
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+            return true;
+    }
+    return false;
+}
+
+const char *PerfCounters::error() const
+{
+    if (!failure)
+        return nullptr;
+#ifdef __linux__
+    // the usual reasons, with what to do about them
+    if (failure == EACCES || failure == EPERM)
+        return "not permitted, lower /proc/sys/kernel/perf_event_paranoid";
+    if (failure == ENOENT || failure == EOPNOTSUPP)
+        return "the cpu or the VM has no such counter";
+    if (failure == ENOSYS)
+        return "the kernel has no perf events";
+    return strerror(failure);
+#else
+    return "only supported on Linux";
+#endif
+}
+
+// PERF_EVENT_IOC_RESET only zeroes the count, the times keep adding up
+// from the open so they are read here and stop() uses the differences
+void PerfCounters::start()
+{
+#ifdef __linux__
+    for (int i = 0; i < (int)PerfCounter::COUNT; i++)
+    {
+        u64 read_format[3];
+        if (fds[i] < 0)
+            continue;
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        if (readEvent(fds[i], read_format))
+        {
+            enabled[i] = read_format[1];
+            running[i] = read_format[2];
+        }
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    // a counter that only ran part of the time since start() is
+    // extrapolated to the whole of it
+    for (int i = 0; i < (int)PerfCounter::COUNT; i++)
+    {
+        u64 read_format[3];
+        values[i] = 0;
+        if (!readEvent(fds[i], read_format))
+            continue;
+        u64 time_enabled = read_format[1] - enabled[i], time_running = read_format[2] - running[i];
+        if (time_running == 0)
+            continue;
+        values[i] = time_running < time_enabled ? (u64)((double)read_format[0] * time_enabled / time_running)
+                                                : read_format[0];
+    }
+#endif
+}
+
+u64 PerfCounters::value(PerfCounter counter) const
+{
+    return values[(int)counter];
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+}
+
+const char *PerfCounters::name(PerfCounter counter)
+{
+    static const char *names[(int)PerfCounter::COUNT] = {"instructions", "cycles", "branch-misses", "L1d-misses",
+                                                          "LLC-misses"};
+    return names[(int)counter];
+}
\ No newline at end of file
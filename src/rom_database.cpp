@@ -0,0 +1,172 @@
+#include "../include/rom_database.h"
+#include "../include/chip8.h"
+
+#include <cstdio>
+#include <cstring>
+
+RomDatabase::RomDatabase() : header(nullptr), records(nullptr)
+{
+}
+
+bool RomDatabase::open(const char *path)
+{
+    header = nullptr;
+    records = nullptr;
+
+    if (!file.open(path) || file.size() < sizeof(Header))
+    {
+        return false;
+    }
+
+    const Header *h = (const Header *)file.data();
+    if (h->magic != ROMDB_MAGIC || h->version != ROMDB_VERSION ||
+        !h->buckets || (h->buckets & (h->buckets - 1)) ||
+        file.size() < sizeof(Header) + (size_t)h->buckets * sizeof(Record))
+    {
+        file.close();
+        return false;
+    }
+
+    header = h;
+    records = (const Record *)(file.data() + sizeof(Header));
+    return true;
+}
+
+// SHA-1 is already uniformly distributed, its first bytes are the hash
+u32 RomDatabase::bucketOf(const u8 digest[SHA1_SIZE], u32 buckets)
+{
+    u32 value;
+    memcpy(&value, digest, sizeof(value));
+    return value & (buckets - 1);
+}
+
+// settings the emulator can run with, a corrupt or newer index may hold
+// variants, profiles or keys that don't exist here
+static bool validRecord(u8 variant, u8 quirks, u16 cycles_per_frame, const u8 keymap[KEYPAD_SIZE])
+{
+    if (variant > (u8)Variant::XOCHIP || quirks > (u8)QuirkProfile::VIP_TIMED || cycles_per_frame == 0)
+        return false;
+    for (int i = 0; i < KEYPAD_SIZE; i++)
+    {
+        if (keymap[i] >= KEYPAD_SIZE)
+            return false;
+    }
+    return true;
+}
+
+bool RomDatabase::lookup(const u8 digest[SHA1_SIZE], RomInfo &info) const
+{
+    if (!header)
+    {
+        return false;
+    }
+
+    // linear probing, the table is at most half full
+    u32 mask = header->buckets - 1;
+    for (u32 i = bucketOf(digest, header->buckets), probes = 0; probes < header->buckets; i = (i + 1) & mask, probes++)
+    {
+        const Record &record = records[i];
+        if (!record.used)
+        {
+            return false;
+        }
+        if (memcmp(record.digest, digest, SHA1_SIZE) == 0)
+        {
+            if (!validRecord(record.variant, record.quirks, record.cycles_per_frame, record.keymap))
+                return false;
+            info.variant = (Variant)record.variant;
+            info.quirks = (QuirkProfile)record.quirks;
+            info.cycles_per_frame = record.cycles_per_frame;
+            memcpy(info.keymap, record.keymap, KEYPAD_SIZE);
+            return true;
+        }
+    }
+    return false;
+}
+
+u32 RomDatabase::size() const
+{
+    return header ? header->count : 0;
+}
+
+bool RomDatabase::build(const char *path, const std::vector<RomEntry> &entries)
+{
+    // at least twice as many buckets as entries keeps the probes short
+    u32 buckets = 1;
+    while (buckets < 2 * entries.size())
+        buckets <<= 1;
+
+    std::vector<Record> table(buckets);
+    memset(table.data(), 0, table.size() * sizeof(Record));
+
+    u32 count = 0;
+    for (const RomEntry &entry : entries)
+    {
+        u32 i = bucketOf(entry.digest, buckets);
+        while (table[i].used && memcmp(table[i].digest, entry.digest, SHA1_SIZE) != 0)
+            i = (i + 1) & (buckets - 1);
+
+        // a duplicate hash overrides the previous line
+        Record &record = table[i];
+        if (!record.used)
+            count++;
+        memcpy(record.digest, entry.digest, SHA1_SIZE);
+        record.used = 1;
+        record.variant = (u8)entry.info.variant;
+        record.quirks = (u8)entry.info.quirks;
+        record.cycles_per_frame = entry.info.cycles_per_frame;
+        memcpy(record.keymap, entry.info.keymap, KEYPAD_SIZE);
+    }
+
+    Header h = {ROMDB_MAGIC, ROMDB_VERSION, buckets, count};
+
+    FILE *out = fopen(path, "wb");
+    if (!out)
+    {
+        return false;
+    }
+    bool written = fwrite(&h, sizeof(h), 1, out) == 1 &&
+                   fwrite(table.data(), sizeof(Record), table.size(), out) == table.size();
+    return (fclose(out) == 0) && written;
+}
+
+RomInfo defaultRomInfo(Variant variant)
+{
+    RomInfo info;
+    info.variant = variant;
+    info.quirks = defaultQuirks(variant);
+    info.cycles_per_frame = CYCLES_PER_FRAME;
+    for (int i = 0; i < KEYPAD_SIZE; i++)
+        info.keymap[i] = (u8)i;
+    return info;
+}
+
+bool variantFromName(const char *name, Variant &variant)
+{
+    if (strcmp(name, "chip8") == 0)
+        variant = Variant::CHIP8;
+    else if (strcmp(name, "schip") == 0)
+        variant = Variant::SCHIP;
+    else if (strcmp(name, "xochip") == 0)
+        variant = Variant::XOCHIP;
+    else
+        return false;
+    return true;
+}
+
+bool quirksFromName(const char *name, QuirkProfile &quirks)
+{
+    if (strcmp(name, "default") == 0)
+        quirks = QuirkProfile::DEFAULT;
+    else if (strcmp(name, "vip") == 0)
+        quirks = QuirkProfile::VIP;
+    else if (strcmp(name, "schip") == 0)
+        quirks = QuirkProfile::SCHIP;
+    else if (strcmp(name, "xochip") == 0)
+        quirks = QuirkProfile::XOCHIP;
+    else if (strcmp(name, "vip-timed") == 0)
+        quirks = QuirkProfile::VIP_TIMED;
+    else
+        return false;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "../include/chip8.h"
+#include "../include/mapped_file.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// the loaders touching the file system, kept out of chip8.cpp so the
+// interpreter itself builds without any OS headers
+
+bool Chip8::loadROM(const char *path)
+{
+    // regular files are mapped and copied in one go
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return false;
+    if ((info.st_mode & S_IFMT) == S_IFREG)
+    {
+        MappedFile file;
+        if (info.st_size == 0)
+            return true;
+        return file.open(path) && loadROM(file.data(), file.size());
+    }
+
+    // named pipes and devices can't be mapped, opening them twice would
+    // also lose the writer, so they are read instead
+#ifdef _WIN32
+    int fd = _open(path, _O_RDONLY | _O_BINARY);
+#else
+    int fd = open(path, O_RDONLY);
+#endif
+    if (fd < 0)
+        return false;
+    bool loaded = loadROM(fd);
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+    return loaded;
+}
+
+// reads straight into memory till end of file, the descriptor isn't closed
+// a read interrupted by a signal before it got anything is tried again
+static long readRetrying(int fd, u8 *destination, size_t size)
+{
+    for (;;)
+    {
+#ifdef _WIN32
+        long count = _read(fd, destination, (unsigned)size);
+#else
+        long count = (long)read(fd, destination, size);
+#endif
+        if (count >= 0 || errno != EINTR)
+            return count;
+    }
+}
+
+bool Chip8::loadROM(int fd)
+{
+    size_t capacity;
+    u8 *destination = program(capacity);
+    size_t loaded = 0;
+    memory_stale = true;
+    while (loaded < capacity)
+    {
+        long count = readRetrying(fd, destination + loaded, capacity - loaded);
+        if (count < 0)
+            return false;
+        if (count == 0)
+            return true;
+        loaded += (size_t)count;
+    }
+
+    // memory is full, anything left means the program doesn't fit
+    u8 extra;
+    return readRetrying(fd, &extra, 1) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "../include/sha1.h"
+
+#include <cstring>
+
+static u32 rotl(u32 value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// compresses one 64 bytes block into the state
+static void sha1Block(u32 state[5], const u8 *block)
+{
+    u32 w[80];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = ((u32)block[4 * i] << 24) | ((u32)block[4 * i + 1] << 16) |
+               ((u32)block[4 * i + 2] << 8) | (u32)block[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++)
+    {
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i++)
+    {
+        u32 f, k;
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999u;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1u;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDCu;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6u;
+        }
+
+        u32 temp = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void sha1(const u8 *data, size_t size, u8 digest[SHA1_SIZE])
+{
+    u32 state[5] = {0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u};
+
+    size_t full = size - size % 64;
+    for (size_t i = 0; i < full; i += 64)
+    {
+        sha1Block(state, data + i);
+    }
+
+    // padding: 0x80, zeros, then the length in bits as big endian 64-bit
+    u8 tail[128];
+    size_t rest = size - full;
+    memset(tail, 0, sizeof(tail));
+    if (rest)
+        memcpy(tail, data + full, rest);
+    tail[rest] = 0x80u;
+
+    size_t tail_size = (rest < 56) ? 64 : 128;
+    u64 bits = (u64)size * 8;
+    for (int i = 0; i < 8; i++)
+    {
+        tail[tail_size - 1 - i] = (u8)(bits >> (8 * i));
+    }
+
+    sha1Block(state, tail);
+    if (tail_size == 128)
+        sha1Block(state, tail + 64);
+
+    for (int i = 0; i < 5; i++)
+    {
+        digest[4 * i] = (u8)(state[i] >> 24);
+        digest[4 * i + 1] = (u8)(state[i] >> 16);
+        digest[4 * i + 2] = (u8)(state[i] >> 8);
+        digest[4 * i + 3] = (u8)state[i];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "../include/snapshot.h"
+#include "../include/chip8.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+Snapshot::Snapshot() : header(nullptr)
+{
+}
+
+bool Snapshot::open(const char *path, const u8 digest[SHA1_SIZE])
+{
+    close();
+    if (!file.open(path))
+        return false;
+
+    // a snapshot of another ROM, an older format or a truncated file is as good as none
+    const Header *mapped = (const Header *)file.data();
+    if (file.size() < sizeof(Header) || mapped->magic != SNAPSHOT_MAGIC || mapped->version != SNAPSHOT_VERSION ||
+        memcmp(mapped->digest, digest, SHA1_SIZE) != 0 || file.size() - sizeof(Header) != mapped->size)
+    {
+        close();
+        return false;
+    }
+    header = mapped;
+    return true;
+}
+
+bool Snapshot::restore(Chip8 &chip8) const
+{
+    return header && chip8.loadState(file.data() + sizeof(Header), header->size);
+}
+
+SnapshotInfo Snapshot::info() const
+{
+    SnapshotInfo info = {0, 0, 0};
+    if (header)
+    {
+        info.frame = header->frame;
+        info.seed = header->seed;
+        info.cycles_per_frame = header->cycles_per_frame;
+    }
+    return info;
+}
+
+void Snapshot::close()
+{
+    file.close();
+    header = nullptr;
+}
+
+bool Snapshot::write(const char *path, const Chip8 &chip8, const u8 digest[SHA1_SIZE], const SnapshotInfo &info)
+{
+    std::vector<u8> state(chip8.stateSize());
+    chip8.saveState(state.data());
+    return write(path, state.data(), state.size(), digest, info);
+}
+
+bool Snapshot::write(const char *path, const u8 *state, size_t size, const u8 digest[SHA1_SIZE],
+                     const SnapshotInfo &info)
+{
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    memcpy(header.digest, digest, SHA1_SIZE);
+    header.size = (u32)size;
+    header.frame = info.frame;
+    header.seed = info.seed;
+    header.cycles_per_frame = info.cycles_per_frame;
+
+    // only the last directory of the path is created, failing is fine if it exists
+    std::string directory(path);
+    size_t slash = directory.find_last_of("/\\");
+    if (slash != std::string::npos && slash > 0)
+    {
+        directory.resize(slash);
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+    }
+
+    std::string temporary = std::string(path) + ".tmp";
+    FILE *out = fopen(temporary.c_str(), "wb");
+    if (!out)
+        return false;
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(state, 1, size, out) == size;
+    written &= fclose(out) == 0;
+    if (!written)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+
+    // rename() replaces the target atomically on POSIX, Windows refuses existing targets
+#ifdef _WIN32
+    remove(path);
+#endif
+    return rename(temporary.c_str(), path) == 0;
+}
+
+std::string Snapshot::path(const char *directory, const u8 digest[SHA1_SIZE], const char *extension)
+{
+    char hex[SHA1_SIZE * 2 + 1];
+    for (int i = 0; i < SHA1_SIZE; i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    return std::string(directory) + "/" + hex + "." + extension;
+}
+
+SnapshotWriter::SnapshotWriter() : full(false), writing(false), stop(false), failed(0)
+{
+}
+
+void SnapshotWriter::submit(const std::string &path, const Chip8 &chip8, const u8 digest[SHA1_SIZE],
+                            const SnapshotInfo &info)
+{
+    // filled outside the lock, the writer never touches the spare buffers
+    spare.path = path;
+    spare.state.resize(chip8.stateSize());
+    chip8.saveState(spare.state.data());
+    memcpy(spare.digest, digest, SHA1_SIZE);
+    spare.info = info;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(mailbox, spare);
+        full = true;
+        if (!worker.joinable())
+            worker = std::thread(&SnapshotWriter::writeLoop, this);
+    }
+    wake.notify_one();
+}
+
+void SnapshotWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return !full && !writing; });
+}
+
+u64 SnapshotWriter::failures() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+// what was submitted before stop is still written
+void SnapshotWriter::writeLoop()
+{
+    Job job;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        wake.wait(lock, [this] { return full || stop; });
+        if (!full)
+            break;
+        std::swap(job, mailbox);
+        full = false;
+        writing = true;
+
+        lock.unlock();
+        bool written = Snapshot::write(job.path.c_str(), job.state.data(), job.state.size(), job.digest, job.info);
+        lock.lock();
+
+        failed += !written;
+        writing = false;
+        idle.notify_all();
+    }
+}
\ No newline at end of file
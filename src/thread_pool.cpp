@@ -0,0 +1,76 @@
+#include "../include/thread_pool.h"
+
+ThreadPool::ThreadPool(int threads)
+    : task(nullptr), count(0), next(0), busy(0), generation(0), stop(false)
+{
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+int ThreadPool::size() const
+{
+    return (int)workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &task)
+{
+    if (workers.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->count = count;
+        next.store(0, std::memory_order_relaxed);
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    drain();
+
+    // the task lives on the caller's stack, no worker may still be using it
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+}
+
+void ThreadPool::work()
+{
+    u64 seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [&] { return stop || generation != seen; });
+        if (stop)
+            return;
+        seen = generation;
+
+        lock.unlock();
+        drain();
+        lock.lock();
+        if (--busy == 0)
+            finished.notify_one();
+    }
+}
+
+void ThreadPool::drain()
+{
+    for (int i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed))
+        (*task)(i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "../include/vec_env.h"
+#include "../include/chip8.h"
+#include "../include/thread_pool.h"
+#include <vector>
+
+#define OBSERVATION_SIZE (CHIP8ENV_WIDTH * CHIP8ENV_HEIGHT)
+
+struct chip8env
+{
+    std::vector<std::unique_ptr<Chip8>> machines;
+    std::vector<u8> loaded;                     // state right after loading the ROM, episodes restart from it
+    std::vector<u8> ended;                      // episodes to restart on the next step
+    std::vector<u64> episodes;                  // episodes each machine started, picks its next seed
+    int frames_per_step;
+    int cycles_per_frame;
+    u64 seed;
+    chip8env_reward_fn reward;
+    void *user;
+    ThreadPool pool;
+
+    chip8env(int threads) : pool(threads) {}
+};
+
+// palette indices straight from the bitplanes, hires keeps every other pixel
+static void observe(const Frame &frame, u8 *out)
+{
+    int step = (frame.width == HIRES_WIDTH) ? 2 : 1;
+    for (int y = 0; y < CHIP8ENV_HEIGHT; y++)
+    {
+        for (int x = 0; x < CHIP8ENV_WIDTH; x++)
+            out[y * CHIP8ENV_WIDTH + x] = frame.pixel(x * step, y * step);
+    }
+}
+
+// every episode gets its own CXNN sequence, the same ones on every run
+static void restart(chip8env *env, int index)
+{
+    Chip8 &chip8 = *env->machines[index];
+    chip8.loadState(env->loaded.data(), env->loaded.size());
+    chip8.clearFault();
+    chip8.seed(env->seed + (u64)index + env->episodes[index] * env->machines.size());
+    env->episodes[index]++;
+    env->ended[index] = 0;
+}
+
+chip8env *chip8env_create(const uint8_t *rom, size_t size, int count, int variant, int quirks,
+                          int frames_per_step, int cycles_per_frame, int threads, uint64_t seed)
+{
+    if (count < 1 || frames_per_step < 1 || cycles_per_frame < 0 || variant < CHIP8ENV_CHIP8 ||
+        variant > CHIP8ENV_XOCHIP || quirks < CHIP8ENV_DEFAULT_QUIRKS || quirks > (int)QuirkProfile::VIP_TIMED)
+    {
+        return nullptr;
+    }
+
+    // the ROM is loaded once, every machine starts from a copy of that state
+    Variant machine = (Variant)variant;
+    QuirkProfile profile = (quirks == CHIP8ENV_DEFAULT_QUIRKS) ? defaultQuirks(machine) : (QuirkProfile)quirks;
+    std::unique_ptr<Chip8> first = createChip8(machine, profile);
+    if (!first->loadROM(rom, size))
+        return nullptr;
+
+    chip8env *env = new chip8env(threads);
+    env->loaded.resize(first->stateSize());
+    first->saveState(env->loaded.data());
+    env->machines.push_back(std::move(first));
+    for (int i = 1; i < count; i++)
+        env->machines.push_back(createChip8(machine, profile));
+    env->ended.assign(count, 0);
+    env->episodes.assign(count, 0);
+    env->frames_per_step = frames_per_step;
+    env->cycles_per_frame = cycles_per_frame ? cycles_per_frame : CYCLES_PER_FRAME;
+    env->seed = seed;
+    env->reward = nullptr;
+    env->user = nullptr;
+    for (int i = 0; i < count; i++)
+        restart(env, i);
+    return env;
+}
+
+void chip8env_destroy(chip8env *env)
+{
+    delete env;
+}
+
+int chip8env_count(const chip8env *env)
+{
+    return (int)env->machines.size();
+}
+
+void chip8env_set_reward(chip8env *env, chip8env_reward_fn reward, void *user)
+{
+    env->reward = reward;
+    env->user = user;
+}
+
+void chip8env_reset(chip8env *env, uint8_t *observations)
+{
+    env->pool.parallelFor((int)env->machines.size(), [&](int i) {
+        restart(env, i);
+        observe(env->machines[i]->display, observations + (size_t)i * OBSERVATION_SIZE);
+    });
+}
+
+// each task touches machine i and slot i of the caller's arrays only
+void chip8env_step(chip8env *env, const uint16_t *actions, uint8_t *observations, float *rewards, uint8_t *dones)
+{
+    env->pool.parallelFor((int)env->machines.size(), [&](int i) {
+        if (env->ended[i])
+            restart(env, i);
+
+        Chip8 &chip8 = *env->machines[i];
+        for (int k = 0; k < KEYPAD_SIZE; k++)
+            chip8.keypad[k] = (actions[i] >> k) & 1u;
+
+        // a fault ends the episode, the machine can't be trusted past it
+        u8 done = 0;
+        for (int f = 0; f < env->frames_per_step && !done; f++)
+        {
+            RunResult result = chip8.runFrame(env->cycles_per_frame);
+            chip8.updateTimers();
+            done = result.reason == StopReason::STACK_FAULT || result.reason == StopReason::ILLEGAL_OPCODE;
+        }
+
+        float reward = env->reward ? env->reward(env->user, env, i, &done) : 0.0f;
+        observe(chip8.display, observations + (size_t)i * OBSERVATION_SIZE);
+        env->ended[i] = done;
+        if (rewards)
+            rewards[i] = reward;
+        if (dones)
+            dones[i] = done;
+    });
+}
+
+uint8_t chip8env_peek(const chip8env *env, int index, uint32_t address)
+{
+    return env->machines[index]->peek(address);
+}
+
+uint8_t chip8env_register(const chip8env *env, int index, int x)
+{
+    return env->machines[index]->reg((u8)x);
+}
\ No newline at end of file
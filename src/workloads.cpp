@@ -0,0 +1,154 @@
+#include "../include/workloads.h"
+#include "../include/assembler.h"
+
+#include <cstring>
+
+// every register but VF, which the arithmetic clobbers
+static const char alu_source[] = R"(
+        LD V0, 1
+        LD V1, 3
+        LD V2, 5
+        LD V3, 7
+loop:   ADD V0, V1
+        XOR V2, V0
+        OR V3, V2
+        AND V4, V3
+        SUB V5, V0
+        SUBN V6, V1
+        SHR V7, V5
+        SHL V8, V6
+        ADD V9, 7
+        LD VA, V9
+        ADD VA, V4
+        SE VA, 0x40
+        SNE VB, V0
+        ADD VB, 1
+        JP loop
+)";
+
+// 2^7 leaves per iteration, the deepest call uses 8 of the 16 stack entries
+static const char calls_source[] = R"(
+loop:   CALL level1
+        ADD V0, 1
+        JP loop
+level1: CALL level2
+        CALL level2
+        RET
+level2: CALL level3
+        CALL level3
+        RET
+level3: CALL level4
+        CALL level4
+        RET
+level4: CALL level5
+        CALL level5
+        RET
+level5: CALL level6
+        CALL level6
+        RET
+level6: CALL level7
+        CALL level7
+        RET
+level7: CALL leaf
+        CALL leaf
+        RET
+leaf:   ADD V1, 1
+        RET
+)";
+
+// rows of 8x8 sprites covering the screen, each pass starts at a different
+// x so most of them straddle two display bytes and the last one is clipped
+static const char sprites_source[] = R"(
+        LD I, sprite
+        LD V2, 0                ; x of the first column, 0 to 7
+screen: LD V1, 0
+row:    LD V0, V2
+        LD V3, 8                ; sprites left in the row
+column: DRW V0, V1, 8
+        ADD V0, 8
+        ADD V3, -1
+        SE V3, 0
+        JP column
+        ADD V1, 8
+        SE V1, 32
+        JP row
+        ADD V2, 3
+        LD V4, 7
+        AND V2, V4
+        JP screen
+sprite: DB 0x3C, 0x42, 0xA5, 0x81, 0xA5, 0x99, 0x42, 0x3C
+)";
+
+// 224 bytes from the start of the program to 0x400, 14 at a time through V0-VD.
+// I is set before every transfer so the memory increment quirk doesn't matter
+static const char memcopy_source[] = R"(
+start:  LD VE, 0                ; offset of the block
+copy:   LD I, start
+        ADD I, VE
+        LD VD, [I]
+        LD I, 0x400
+        ADD I, VE
+        LD [I], VD
+        ADD VE, 14
+        SE VE, 224
+        JP copy
+        JP start
+)";
+
+// patch alternates between ADD V3 and ADD V4, its immediate going up by one
+// every time, so no instruction can be decoded once and reused
+static const char smc_source[] = R"(
+loop:   LD I, patch
+        LD V1, [I]              ; V0 = first byte of patch, V1 = its immediate
+        LD V2, 0x07
+        XOR V0, V2
+        ADD V1, 1
+        LD I, patch
+        LD [I], V1
+patch:  ADD V3, 0
+        JP loop
+)";
+
+static const struct
+{
+    const char *name;
+    const char *source;
+} workloads[(int)Workload::COUNT] = {
+    {"alu", alu_source},
+    {"calls", calls_source},
+    {"sprites", sprites_source},
+    {"memcopy", memcopy_source},
+    {"smc", smc_source},
+};
+
+const char *workloadName(Workload workload)
+{
+    return workloads[(int)workload].name;
+}
+
+bool workloadFromName(const char *name, Workload &workload)
+{
+    for (int i = 0; i < (int)Workload::COUNT; i++)
+    {
+        if (strcmp(name, workloads[i].name) == 0)
+        {
+            workload = (Workload)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *workloadSource(Workload workload)
+{
+    return workloads[(int)workload].source;
+}
+
+// the sources are part of the build, they always assemble
+std::vector<u8> workloadROM(Workload workload)
+{
+    std::vector<u8> rom;
+    std::string error;
+    assemble(workloadSource(workload), rom, error);
+    return rom;
+}
\ No newline at end of file
@@ -0,0 +1,1337 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "../include/assembler.h"
+#include "../include/chip8.h"
+#include "../include/expand.h"
+#include "../include/movie.h"
+#include "../include/rom_database.h"
+#include "../include/sha1.h"
+#include "../include/snapshot.h"
+#include "../include/testing_utils.h"
+#include "../include/thread_pool.h"
+#include "../include/vec_env.h"
+#include "../include/workloads.h"
+
+#undef main
+
+bool loadProgram(Chip8 &chip8, const std::vector<u8> &program)
+{
+    return chip8.loadROM(program.data(), program.size());
+}
+
+void testWaitForKey(std::string test_name)
+{
+    bool passed = true;
+
+    // F00A: V0 = key, then 1202: loop forever
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= loadProgram(chip8, {0xF0, 0x0A, 0x12, 0x02});
+
+    bool draw = false;
+    chip8.clock(draw);
+    passed &= chip8.isWaiting();
+
+    // no key: clock() doesn't fetch anything
+    for (int i = 0; i < 10; i++)
+        chip8.clock(draw);
+    passed &= chip8.isWaiting();
+
+    chip8.keypad[0x7] = 1;
+    chip8.clock(draw);
+    passed &= !chip8.isWaiting();
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testTimersWhileWaiting(std::string test_name)
+{
+    bool passed = true;
+
+    // V0 = 3, sound_timer = V0, F10A: wait
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= loadProgram(chip8, {0x60, 0x03, 0xF0, 0x18, 0xF1, 0x0A});
+
+    bool draw = false;
+    for (int i = 0; i < 3; i++)
+        chip8.clock(draw);
+    passed &= chip8.isWaiting();
+
+    // the sound stops on the third tick even though nothing executes
+    passed &= chip8.soundTimer() == 3;
+    chip8.updateTimers();
+    chip8.updateTimers();
+    passed &= chip8.soundTimer() == 1;
+    chip8.updateTimers();
+    passed &= chip8.soundTimer() == 0;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void WAIT_KEY_TEST_SUITE()
+{
+    TEST_SUITE_START("FX0A wait state");
+
+    testWaitForKey("FX0A blocks fetching until a key is pressed");
+    testTimersWhileWaiting("timers keep ticking while FX0A waits");
+
+    TEST_SUITE_SUCCESS("FX0A wait state");
+}
+
+void testHiresScroll(std::string test_name)
+{
+    bool passed = true;
+
+    // 00FF: hires, I = big font 0, V0 = 124, DXY0 at (124, 0), 00FB, 00CN(2), 00FC
+    Chip8Core<SChipTraits, SChipQuirks> chip8;
+    passed &= loadProgram(chip8, {0x00, 0xFF, 0xA0, 0xA0, 0x60, 0x7C, 0xD0, 0x10,
+                                  0x00, 0xFB, 0x00, 0xC2, 0x00, 0xFC});
+
+    bool draw = false;
+    for (int i = 0; i < 4; i++)
+        chip8.clock(draw);
+    passed &= chip8.display.width == HIRES_WIDTH && chip8.display.height == HIRES_HEIGHT;
+
+    // the 16 pixels wide sprite is clipped after column 127
+    passed &= chip8.display.pixel(126, 0) && chip8.display.pixel(127, 0);
+    passed &= !chip8.display.pixel(0, 0) && chip8.display.planes[0][0][0] == 0;
+
+    // scrolling right pushes everything past the edge
+    chip8.clock(draw);
+    passed &= chip8.display.planes[0][0][1] == 0 && chip8.display.planes[0][1][1] == 0;
+
+    // redraw, scroll 2 rows down then 4 pixels left across the word boundary
+    Chip8Core<SChipTraits, SChipQuirks> other;
+    passed &= loadProgram(other, {0x00, 0xFF, 0xA0, 0xA0, 0x60, 0x3C, 0xD0, 0x10,
+                                  0x00, 0xC2, 0x00, 0xFC});
+    for (int i = 0; i < 6; i++)
+        other.clock(draw);
+    // first font row 0x3C7E drawn at column 60, pixels 60 and 61 came from the second word
+    passed &= !other.display.pixel(57, 2) && other.display.pixel(58, 2);
+    passed &= other.display.pixel(60, 2) && other.display.pixel(61, 2);
+    passed &= !other.display.pixel(64, 2) && other.display.pixel(65, 2) && !other.display.pixel(71, 2);
+    passed &= other.display.planes[0][0][0] == 0 && other.display.planes[0][1][0] == 0;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testFlagRegisters(std::string test_name)
+{
+    bool passed = true;
+
+    // V0 = 1, V1 = 2, FX75(1), V0 = 0, V1 = 0, FX85(1)
+    Chip8Core<SChipTraits, SChipQuirks> chip8;
+    passed &= loadProgram(chip8, {0x60, 0x01, 0x61, 0x02, 0xF1, 0x75, 0x60, 0x00,
+                                  0x61, 0x00, 0xF1, 0x85, 0x50, 0x10, 0x12, 0x0E,
+                                  0x00, 0xFF});
+
+    // 5010 skips the jump only if V0 == V1, which means the flags weren't restored
+    bool draw = false;
+    for (int i = 0; i < 8; i++)
+        chip8.clock(draw);
+    passed &= chip8.display.width == DISPLAY_WIDHT;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void SUPER_CHIP_TEST_SUITE()
+{
+    TEST_SUITE_START("SUPER-CHIP");
+
+    testHiresScroll("hires 16x16 sprites and scrolling on packed rows");
+    testFlagRegisters("FX75/FX85 save and restore the flag registers");
+
+    TEST_SUITE_SUCCESS("SUPER-CHIP");
+}
+
+void testLongIndex(std::string test_name)
+{
+    bool passed = true;
+
+    // V0 = 1, 3001 skips the 4 bytes F000 00FF, V1..V3 = 7,8,9,
+    // F000 0300, 5132 stores V1..V3, 5533 loads them back into V5..V3
+    Chip8Core<XOChipTraits, XOChipQuirks> chip8;
+    passed &= loadProgram(chip8, {0x60, 0x01, 0x30, 0x01, 0xF0, 0x00, 0x00, 0xFF,
+                                  0x61, 0x07, 0x62, 0x08, 0x63, 0x09, 0xF0, 0x00,
+                                  0x03, 0x00, 0x51, 0x32, 0x55, 0x33, 0x45, 0x09,
+                                  0x00, 0xFF});
+
+    // V5 = 7 from the first byte, so 4509 skips the 00FF
+    bool draw = false;
+    for (int i = 0; i < 10; i++)
+        chip8.clock(draw);
+    passed &= chip8.display.width == DISPLAY_WIDHT;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testBitplanes(std::string test_name)
+{
+    bool passed = true;
+
+    // F301: both planes, I = 0x208, D001 draws 0x80 on plane 0 and 0xC0 on plane 1
+    Chip8Core<XOChipTraits, XOChipQuirks> chip8;
+    passed &= loadProgram(chip8, {0xF3, 0x01, 0xA2, 0x08, 0xD0, 0x01, 0x12, 0x06,
+                                  0x80, 0xC0});
+
+    bool draw = false;
+    for (int i = 0; i < 3; i++)
+        chip8.clock(draw);
+    passed &= chip8.display.pixel(0, 0) == 3 && chip8.display.pixel(1, 0) == 2;
+
+    u32 colors[4] = {10, 11, 12, 13};
+    static u32 out[HIRES_WIDTH * HIRES_HEIGHT];
+    expandFrame(chip8.display, colors, 1, out, chip8.display.width);
+    passed &= out[0] == 13 && out[1] == 12 && out[2] == 10 && out[DISPLAY_WIDHT] == 10;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void XO_CHIP_TEST_SUITE()
+{
+    TEST_SUITE_START("XO-CHIP");
+
+    testLongIndex("F000 NNNN, 4 bytes skips and 5XY2/5XY3 register ranges");
+    testBitplanes("two bitplanes drawn and composited to 4 colors");
+
+    TEST_SUITE_SUCCESS("XO-CHIP");
+}
+
+void testQuirkProfiles(std::string test_name)
+{
+    bool passed = true;
+
+    // VF = 5, V1 = 3, V0 = 8, 8011, 3F00 skips the 00FF only if VF was reset
+    std::vector<u8> reset_check = {0x6F, 0x05, 0x61, 0x03, 0x60, 0x08, 0x80, 0x11,
+                                   0x3F, 0x00, 0x00, 0xFF};
+    bool draw = false;
+
+    std::unique_ptr<Chip8> schip_vip = createChip8(Variant::SCHIP, QuirkProfile::VIP);
+    passed &= schip_vip->quirks() == QuirkProfile::VIP;
+    passed &= loadProgram(*schip_vip, reset_check);
+    for (int i = 0; i < 6; i++)
+        schip_vip->clock(draw);
+    passed &= schip_vip->display.width == DISPLAY_WIDHT;
+
+    std::unique_ptr<Chip8> schip = createChip8(Variant::SCHIP);
+    passed &= loadProgram(*schip, reset_check);
+    for (int i = 0; i < 6; i++)
+        schip->clock(draw);
+    passed &= schip->display.width == HIRES_WIDTH;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testSpriteWrapping(std::string test_name)
+{
+    bool passed = true;
+
+    // V0 = 60, V1 = 31, I = font 0, D015 at the bottom right corner
+    std::vector<u8> program = {0x60, 0x3C, 0x61, 0x1F, 0xA0, 0x50, 0xD0, 0x15};
+    bool draw = false;
+
+    // clipped: only the first row's left half is visible
+    std::unique_ptr<Chip8> clipped = createChip8(Variant::CHIP8, QuirkProfile::DEFAULT);
+    passed &= loadProgram(*clipped, program);
+    for (int i = 0; i < 4; i++)
+        clipped->clock(draw);
+    passed &= clipped->display.pixel(60, 31) && !clipped->display.pixel(0, 31) && !clipped->display.pixel(60, 0);
+
+    // wrapped: 0xF0 covers columns 60..63, the 0x90 rows come back on the top
+    std::unique_ptr<Chip8> wrapped = createChip8(Variant::CHIP8, QuirkProfile::XOCHIP);
+    passed &= loadProgram(*wrapped, program);
+    for (int i = 0; i < 4; i++)
+        wrapped->clock(draw);
+    passed &= wrapped->display.pixel(60, 31) && wrapped->display.pixel(60, 0) && wrapped->display.pixel(63, 0);
+
+    // an 8 pixels sprite at column 60 wraps its right half to column 0
+    std::vector<u8> wide = {0x60, 0x3C, 0xA2, 0x08, 0xD0, 0x11, 0x12, 0x06, 0xFF};
+    std::unique_ptr<Chip8> wide_wrapped = createChip8(Variant::CHIP8, QuirkProfile::XOCHIP);
+    passed &= loadProgram(*wide_wrapped, wide);
+    for (int i = 0; i < 3; i++)
+        wide_wrapped->clock(draw);
+    passed &= wide_wrapped->display.pixel(63, 0) && wide_wrapped->display.pixel(3, 0) && !wide_wrapped->display.pixel(4, 0);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testCycleTiming(std::string test_name)
+{
+    bool passed = true;
+
+    // 7001 3032 1200 counts V0 up to 0x32 in 45 VIP cycles a loop, then D001 draws
+    std::vector<u8> count_to_50 = {0x70, 0x01, 0x30, 0x32, 0x12, 0x00, 0xD0, 0x01, 0x12, 0x08};
+    std::vector<u8> count_to_60 = {0x70, 0x01, 0x30, 0x3C, 0x12, 0x00, 0xD0, 0x01, 0x12, 0x08};
+
+    // 50 loops fit in a VIP frame, 11 instructions don't
+    std::unique_ptr<Chip8> timed = createChip8(Variant::CHIP8, QuirkProfile::VIP_TIMED);
+    passed &= loadProgram(*timed, count_to_50);
+    passed &= timed->runFrame(CYCLES_PER_FRAME).drew;
+
+    std::unique_ptr<Chip8> counted = createChip8(Variant::CHIP8, QuirkProfile::VIP);
+    passed &= loadProgram(*counted, count_to_50);
+    passed &= !counted->runFrame(CYCLES_PER_FRAME).drew;
+
+    // 60 loops take 2700 cycles, the draw lands in the second frame
+    std::unique_ptr<Chip8> late = createChip8(Variant::CHIP8, QuirkProfile::VIP_TIMED);
+    passed &= loadProgram(*late, count_to_60);
+    passed &= !late->runFrame(CYCLES_PER_FRAME).drew;
+    late->updateTimers();
+    passed &= late->runFrame(CYCLES_PER_FRAME).drew;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void QUIRKS_TEST_SUITE()
+{
+    TEST_SUITE_START("Quirk profiles");
+
+    testQuirkProfiles("VF reset follows the quirk profile picked at runtime");
+    testSpriteWrapping("sprites clip or wrap at the edges");
+    testCycleTiming("vip-timed frames last VIP machine cycles");
+
+    TEST_SUITE_SUCCESS("Quirk profiles");
+}
+
+void testLoadFromFile(std::string test_name)
+{
+    bool passed = true;
+
+    // A050 D001: draws the top row of the 0 glyph, loaded back from a file on disk
+    const char *path = "core_test.ch8";
+    u8 program[] = {0xA0, 0x50, 0xD0, 0x01};
+    FILE *file = fopen(path, "wb");
+    passed &= file != nullptr;
+    if (file)
+    {
+        fwrite(program, 1, sizeof(program), file);
+        fclose(file);
+    }
+
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= chip8.loadROM(path);
+    remove(path);
+    bool draw = false;
+    chip8.clock(draw);
+    chip8.clock(draw);
+    passed &= draw && chip8.display.pixel(0, 0);
+
+    // missing files are reported
+    passed &= !chip8.loadROM("core_test_missing.ch8");
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testLoadFromPipe(std::string test_name)
+{
+    bool passed = true;
+
+    // the whole ROM comes through a pipe, as from a generator writing to stdout
+    int fds[2];
+    passed &= pipe(fds) == 0;
+    std::vector<u8> program(200, 0x00);
+    program[0] = 0x12;
+    program[1] = 0x00;
+    passed &= write(fds[1], program.data(), program.size()) == (ssize_t)program.size();
+    close(fds[1]);
+
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= chip8.loadROM(fds[0]);
+    close(fds[0]);
+
+    // 1200 jumps to itself forever
+    bool draw = false;
+    for (int i = 0; i < 3; i++)
+        chip8.clock(draw);
+    passed &= !draw;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testLoadTooLarge(std::string test_name)
+{
+    bool passed = true;
+
+    // 3.5KB fill a CHIP-8 after 0x200, one more byte doesn't fit
+    std::vector<u8> program(MEMORY_SIZE - PROGRAM_START, 0x00);
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= loadProgram(chip8, program);
+    program.push_back(0x00);
+    passed &= !loadProgram(chip8, program);
+
+    // same through a descriptor
+    int fds[2];
+    passed &= pipe(fds) == 0;
+    passed &= write(fds[1], program.data(), program.size()) == (ssize_t)program.size();
+    close(fds[1]);
+    passed &= !chip8.loadROM(fds[0]);
+    close(fds[0]);
+
+    // but it fits in the XO-CHIP 64KB
+    Chip8Core<XOChipTraits, XOChipQuirks> xo_chip;
+    passed &= loadProgram(xo_chip, program);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testRomDatabase(std::string test_name)
+{
+    bool passed = true;
+
+    // 100 ROMs, every lookup gets its own settings back
+    const char *path = "core_test.db";
+    std::vector<RomEntry> entries(100);
+    for (u32 i = 0; i < entries.size(); i++)
+    {
+        RomEntry &entry = entries[i];
+        sha1((const u8 *)&i, sizeof(i), entry.digest);
+        entry.info = defaultRomInfo((Variant)(i % 3));
+        entry.info.quirks = (QuirkProfile)(i % ((int)QuirkProfile::VIP_TIMED + 1));
+        entry.info.cycles_per_frame = (u16)(1 + i * 7);
+        for (int k = 0; k < KEYPAD_SIZE; k++)
+            entry.info.keymap[k] = (u8)((k + i) % KEYPAD_SIZE);
+    }
+
+    // a record with a variant this build doesn't know is as good as none
+    entries[99].info.variant = (Variant)7;
+    passed &= RomDatabase::build(path, entries);
+
+    RomDatabase database;
+    passed &= database.open(path) && database.size() == 100;
+    for (u32 i = 0; i < 99; i++)
+    {
+        RomInfo info;
+        const RomInfo &expected = entries[i].info;
+        passed &= database.lookup(entries[i].digest, info) && info.variant == expected.variant &&
+                  info.quirks == expected.quirks && info.cycles_per_frame == expected.cycles_per_frame &&
+                  memcmp(info.keymap, expected.keymap, KEYPAD_SIZE) == 0;
+    }
+    RomInfo info;
+    passed &= !database.lookup(entries[99].digest, info);
+    u8 unknown[SHA1_SIZE];
+    sha1((const u8 *)"unknown", 7, unknown);
+    passed &= !database.lookup(unknown, info);
+    remove(path);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void LOADER_TEST_SUITE()
+{
+    TEST_SUITE_START("ROM loading");
+
+    testLoadFromFile("loads a ROM from a file path");
+    testLoadFromPipe("loads a ROM from a pipe");
+    testLoadTooLarge("rejects ROMs that don't fit in memory");
+
+    testRomDatabase("the ROM index returns what it was built with");
+
+    TEST_SUITE_SUCCESS("ROM loading");
+}
+
+void testMemoryWrap(std::string test_name)
+{
+    bool passed = true;
+
+    // 6080 6180 AFFF F155: V0, V1 stored at 0xFFF and 0x000, then AFFF D012 draws both back
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= loadProgram(chip8, {0x60, 0x80, 0x61, 0x80, 0xAF, 0xFF, 0xF1, 0x55, 0xAF, 0xFF, 0xD0, 0x12, 0x12, 0x0C});
+    bool draw = false;
+    for (int i = 0; i < 4; i++)
+        chip8.clock(draw);
+    passed &= chip8.fault() == Fault::MEMORY;
+    chip8.clearFault();
+    passed &= chip8.fault() == Fault::NONE;
+
+    chip8.clock(draw);
+    chip8.clock(draw);
+    passed &= draw && chip8.display.pixel(0, 0) && chip8.display.pixel(0, 1);
+    passed &= chip8.fault() == Fault::MEMORY;
+
+    // accesses inside memory don't fault, the same bytes are in range on XO-CHIP
+    Chip8Core<XOChipTraits, XOChipQuirks> xo_chip;
+    passed &= loadProgram(xo_chip, {0x60, 0x80, 0x61, 0x80, 0xAF, 0xFF, 0xF1, 0x55, 0xAF, 0xFF, 0xD0, 0x12, 0x12, 0x0C});
+    for (int i = 0; i < 7; i++)
+        xo_chip.clock(draw);
+    passed &= xo_chip.fault() == Fault::NONE;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testGuestIndices(std::string test_name)
+{
+    bool passed = true;
+
+    // 60F7 E09E: V0 = 0xF7 reads key 7, the skipped 1204 would loop, F029 then points at the 7 glyph
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= loadProgram(chip8, {0x60, 0xF7, 0xE0, 0x9E, 0x12, 0x04, 0xF0, 0x29});
+    chip8.keypad[0x7] = 1;
+    bool draw = false;
+    for (int i = 0; i < 3; i++)
+        chip8.clock(draw);
+    passed &= chip8.registers().pc == PROGRAM_START + 8 && chip8.registers().index == FONTS_START + 5 * 7;
+
+    // E0A1 with key 7 down doesn't skip, 1204 loops
+    Chip8Core<Chip8Traits, DefaultQuirks> released;
+    passed &= loadProgram(released, {0x60, 0xF7, 0xE0, 0xA1, 0x12, 0x04});
+    released.keypad[0x7] = 1;
+    for (int i = 0; i < 3; i++)
+        released.clock(draw);
+    passed &= released.registers().pc == PROGRAM_START + 4;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void MEMORY_TEST_SUITE()
+{
+    TEST_SUITE_START("Memory access");
+
+    testMemoryWrap("accesses wrap at the end of memory and report a fault");
+    testGuestIndices("keys and font digits only use the low nibble of Vx");
+
+    TEST_SUITE_SUCCESS("Memory access");
+}
+
+void testRunStops(std::string test_name)
+{
+    bool passed = true;
+
+    // 6001 A050 D001 1200: draws then jumps back to the start
+    std::vector<u8> draw_loop = {0x60, 0x01, 0xA0, 0x50, 0xD0, 0x01, 0x12, 0x00};
+    Chip8Core<Chip8Traits, DefaultQuirks> chip8;
+    passed &= loadProgram(chip8, draw_loop);
+
+    RunResult result = chip8.run(100);
+    passed &= result.reason == StopReason::BUDGET && result.cycles == 100 && result.drew;
+    result = chip8.runFrame(CYCLES_PER_FRAME);
+    passed &= result.reason == StopReason::FRAME && result.cycles == CYCLES_PER_FRAME;
+
+    // the frame ended on D001, the next one is four instructions away
+    result = chip8.run(100, true);
+    passed &= result.reason == StopReason::DRAW && result.cycles == 4;
+
+    chip8.setBreakpoint(0x204);
+    result = chip8.run(100);
+    passed &= result.reason == StopReason::BREAKPOINT && result.cycles == 3;
+    chip8.setBreakpoint(NO_BREAKPOINT);
+
+    // F00A stops the run till a key is down
+    Chip8Core<Chip8Traits, DefaultQuirks> waiting;
+    passed &= loadProgram(waiting, {0x60, 0x01, 0xF0, 0x0A, 0x12, 0x00});
+    result = waiting.run(100);
+    passed &= result.reason == StopReason::WAITING && result.cycles == 2;
+    result = waiting.run(100);
+    passed &= result.reason == StopReason::WAITING && result.cycles == 0;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testRunFrameLimit(std::string test_name)
+{
+    bool passed = true;
+
+    // cut after i instructions the frame leaves the state run(i) does
+    std::vector<u8> draw_loop = {0x60, 0x01, 0xA0, 0x50, 0xD0, 0x01, 0x12, 0x00};
+    for (u32 i = 1; i <= CYCLES_PER_FRAME; i++)
+    {
+        Chip8Core<Chip8Traits, DefaultQuirks> framed, stepped;
+        passed &= loadProgram(framed, draw_loop) && loadProgram(stepped, draw_loop);
+        passed &= framed.runFrame(CYCLES_PER_FRAME, i).cycles == i;
+        stepped.run(i);
+        passed &= framed.fullStateHash() == stepped.fullStateHash();
+        passed &= framed.registers().pc == stepped.registers().pc && framed.registers().opcode == stepped.registers().opcode;
+    }
+
+    // a limit past the frame changes nothing, timed frames are cut the same way
+    Chip8Core<Chip8Traits, DefaultQuirks> whole;
+    passed &= loadProgram(whole, draw_loop);
+    passed &= whole.runFrame(CYCLES_PER_FRAME, 1000).cycles == CYCLES_PER_FRAME;
+    Chip8Core<Chip8Traits, VipTimedQuirks> timed;
+    passed &= loadProgram(timed, draw_loop);
+    passed &= timed.runFrame(CYCLES_PER_FRAME, 2).cycles == 2 && timed.registers().pc == 0x204;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testRunFaults(std::string test_name)
+{
+    bool passed = true;
+
+    // 2200 calls itself, the 17th call overflows the stack
+    Chip8Core<Chip8Traits, DefaultQuirks> recursive;
+    passed &= loadProgram(recursive, {0x22, 0x00});
+    RunResult result = recursive.run(100);
+    passed &= result.reason == StopReason::STACK_FAULT && result.cycles == STACK_SIZE + 1;
+    passed &= recursive.fault() == Fault::STACK;
+
+    // 00EE on an empty stack
+    Chip8Core<Chip8Traits, DefaultQuirks> returning;
+    passed &= loadProgram(returning, {0x00, 0xEE});
+    result = returning.runFrame(CYCLES_PER_FRAME);
+    passed &= result.reason == StopReason::STACK_FAULT && result.cycles == 1;
+
+    // E000 doesn't exist, it's skipped and the run can go on
+    Chip8Core<Chip8Traits, DefaultQuirks> illegal;
+    passed &= loadProgram(illegal, {0xE0, 0x00, 0x12, 0x02});
+    result = illegal.run(100);
+    passed &= result.reason == StopReason::ILLEGAL_OPCODE && result.cycles == 1;
+    passed &= illegal.fault() == Fault::ILLEGAL_OPCODE;
+    result = illegal.run(100);
+    passed &= result.reason == StopReason::BUDGET && result.cycles == 100;
+    illegal.clearFault();
+    passed &= illegal.fault() == Fault::NONE;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void RUN_TEST_SUITE()
+{
+    TEST_SUITE_START("Run loop");
+
+    testRunStops("run() and runFrame() stop on budget, frame, draw, breakpoint and FX0A");
+    testRunFrameLimit("runFrame() cut short after n instructions matches run(n)");
+    testRunFaults("stack faults and unknown opcodes stop the run");
+
+    TEST_SUITE_SUCCESS("Run loop");
+}
+
+// C0FF C1FF C2FF C3FF: four random bytes, then 1200 starts over
+static const std::vector<u8> random_loop = {0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF, 0xC3, 0xFF, 0x12, 0x00};
+
+static std::vector<u8> stateOf(const Chip8 &chip8)
+{
+    std::vector<u8> state(chip8.stateSize());
+    chip8.saveState(state.data());
+    return state;
+}
+
+static void runClocks(Chip8 &chip8, int clocks)
+{
+    bool draw = false;
+    for (int i = 0; i < clocks; i++)
+        chip8.clock(draw);
+}
+
+void testSeededRandom(std::string test_name)
+{
+    bool passed = true;
+
+    // instances with the same seed draw the same numbers
+    Chip8Core<Chip8Traits, DefaultQuirks> first, second, reseeded;
+    passed &= loadProgram(first, random_loop);
+    passed &= loadProgram(second, random_loop);
+    passed &= loadProgram(reseeded, random_loop);
+    reseeded.seed(1234);
+    runClocks(first, 20);
+    runClocks(second, 20);
+    runClocks(reseeded, 20);
+    passed &= stateOf(first) == stateOf(second);
+    passed &= stateOf(first) != stateOf(reseeded);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testStateRoundTrip(std::string test_name)
+{
+    bool passed = true;
+
+    // running on from a loaded state repeats the random numbers drawn after the save
+    Chip8Core<XOChipTraits, XOChipQuirks> chip8;
+    passed &= loadProgram(chip8, random_loop);
+    runClocks(chip8, 7);
+    std::vector<u8> saved = stateOf(chip8);
+    runClocks(chip8, 13);
+    std::vector<u8> expected = stateOf(chip8);
+
+    Chip8Core<XOChipTraits, XOChipQuirks> restored;
+    passed &= restored.loadState(saved.data(), saved.size());
+    runClocks(restored, 13);
+    passed &= stateOf(restored) == expected;
+
+    // other cores and truncated or corrupted states are refused
+    std::unique_ptr<Chip8> other = createChip8(Variant::XOCHIP, QuirkProfile::DEFAULT);
+    passed &= !other->loadState(saved.data(), saved.size());
+    passed &= !restored.loadState(saved.data(), saved.size() - 1);
+    saved[0] ^= 0xFF;
+    passed &= !restored.loadState(saved.data(), saved.size());
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testIncrementalHash(std::string test_name)
+{
+    bool passed = true;
+
+    // A300 C0FF F033 F155: random BCD and registers to memory, A050 D015 draws
+    // at (V0, V1), 7101 00C1 moves down and scrolls, 1200 again
+    std::vector<u8> busy_loop = {0xA3, 0x00, 0xC0, 0xFF, 0xF0, 0x33, 0xF1, 0x55, 0xA0, 0x50,
+                                 0xD0, 0x15, 0x71, 0x01, 0x00, 0xC1, 0x12, 0x00};
+    Chip8Core<XOChipTraits, XOChipQuirks> chip8, reseeded;
+    passed &= loadProgram(chip8, busy_loop);
+    passed &= loadProgram(reseeded, busy_loop);
+    reseeded.seed(99);
+    for (int i = 0; i < 20; i++)
+    {
+        chip8.run(7);
+        reseeded.run(7);
+        passed &= chip8.stateHash() == chip8.fullStateHash();
+        passed &= reseeded.stateHash() == reseeded.fullStateHash();
+        passed &= chip8.stateHash() != reseeded.stateHash();
+    }
+
+    // a loaded state hashes like the machine it was saved from
+    std::vector<u8> saved = stateOf(chip8);
+    Chip8Core<XOChipTraits, XOChipQuirks> restored;
+    passed &= restored.loadState(saved.data(), saved.size());
+    passed &= restored.stateHash() == chip8.stateHash();
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testSnapshots(std::string test_name)
+{
+    bool passed = true;
+
+    // a snapshot restores the machine it was written from, the directory is created
+    const char *directory = "core_test_snapshots";
+    u8 digest[SHA1_SIZE];
+    sha1(random_loop.data(), random_loop.size(), digest);
+    std::string path = Snapshot::path(directory, digest, "boot");
+    Chip8Core<SChipTraits, SChipQuirks> chip8;
+    passed &= loadProgram(chip8, random_loop);
+    chip8.seed(42);
+    runClocks(chip8, 25);
+    SnapshotInfo info = {25, 42, CYCLES_PER_FRAME};
+    passed &= Snapshot::write(path.c_str(), chip8, digest, info);
+
+    Snapshot snapshot;
+    Chip8Core<SChipTraits, SChipQuirks> restored;
+    passed &= snapshot.open(path.c_str(), digest) && snapshot.restore(restored);
+    passed &= restored.stateHash() == chip8.stateHash() && stateOf(restored) == stateOf(chip8);
+    passed &= snapshot.info().frame == 25 && snapshot.info().seed == 42 &&
+              snapshot.info().cycles_per_frame == CYCLES_PER_FRAME;
+
+    // and runs on like it, random numbers included
+    runClocks(chip8, 13);
+    runClocks(restored, 13);
+    passed &= restored.stateHash() == chip8.stateHash();
+
+    // not into another core, and not for another ROM
+    Chip8Core<Chip8Traits, DefaultQuirks> other;
+    passed &= !snapshot.restore(other);
+    snapshot.close();
+    u8 other_digest[SHA1_SIZE];
+    memcpy(other_digest, digest, SHA1_SIZE);
+    other_digest[0] ^= 1;
+    passed &= !snapshot.open(path.c_str(), other_digest);
+
+    // the background writer replaces the file with the latest state
+    SnapshotWriter writer;
+    info.frame = 38;
+    writer.submit(path, chip8, digest, info);
+    writer.flush();
+    passed &= writer.failures() == 0;
+    Chip8Core<SChipTraits, SChipQuirks> resumed;
+    passed &= snapshot.open(path.c_str(), digest) && snapshot.restore(resumed) && snapshot.info().frame == 38;
+    passed &= resumed.stateHash() == chip8.stateHash();
+    snapshot.close();
+    remove(path.c_str());
+    rmdir(directory);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void STATE_TEST_SUITE()
+{
+    TEST_SUITE_START("Save states");
+
+    testSeededRandom("CXNN is reproducible per seed and instance");
+    testStateRoundTrip("states restore the machine and its random sequence");
+    testIncrementalHash("the incremental state hash matches a full rescan");
+    testSnapshots("snapshots restore the machine they were written from");
+
+    TEST_SUITE_SUCCESS("Save states");
+}
+
+void testAssembler(std::string test_name)
+{
+    bool passed = true;
+
+    // forward labels, expressions, every operand kind and a 4 bytes F000
+    std::vector<u8> rom;
+    std::string error;
+    passed &= assemble("start:  LD I, data + 1   ; comment\n"
+                       "        jp v0, start\n"
+                       "        DRW VA, VB, 0xF\n"
+                       "        ADD V1, -1\n"
+                       "        SHR V5\n"
+                       "        LD VF, [I]\n"
+                       "        LD I, LONG 0x1234\n"
+                       "data:   DB #FF, %101, 7 - 2\n"
+                       "        DW data\n",
+                       rom, error);
+    passed &= rom == std::vector<u8>{0xA2, 0x11, 0xB2, 0x00, 0xDA, 0xBF, 0x71, 0xFF, 0x85, 0x56, 0xFF, 0x65,
+                                     0xF0, 0x00, 0x12, 0x34, 0xFF, 0x05, 0x05, 0x02, 0x10};
+
+    // errors name the line and leave no ROM
+    passed &= !assemble("CLS\nLD V0, 256\n", rom, error) && error == "line 2: 256 out of range" && rom.empty();
+    passed &= !assemble("JP nowhere", rom, error) && error == "line 1: unknown label NOWHERE";
+    passed &= !assemble("a: CLS\na: RET", rom, error) && error == "line 2: label A defined twice";
+    passed &= !assemble("LD DT, 5", rom, error) && error == "line 1: invalid operands for LD";
+    passed &= !assemble("HALT", rom, error) && error == "line 1: unknown instruction HALT";
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testWorkloads(std::string test_name)
+{
+    bool passed = true;
+
+    // every workload runs on every core without a fault, the same way twice
+    for (int w = 0; w < (int)Workload::COUNT; w++)
+    {
+        std::vector<u8> rom = workloadROM((Workload)w);
+        passed &= !rom.empty();
+        for (Variant variant : {Variant::CHIP8, Variant::SCHIP, Variant::XOCHIP})
+        {
+            std::unique_ptr<Chip8> first = createChip8(variant), second = createChip8(variant);
+            passed &= loadProgram(*first, rom) && loadProgram(*second, rom);
+            for (int frame = 0; frame < 300; frame++)
+            {
+                first->runFrame(CYCLES_PER_FRAME);
+                second->runFrame(CYCLES_PER_FRAME);
+                first->updateTimers();
+                second->updateTimers();
+            }
+            passed &= first->fault() == Fault::NONE && first->fullStateHash() == second->fullStateHash();
+        }
+    }
+
+    // memcopy leaves a copy of its first 224 bytes at 0x400
+    Chip8Core<Chip8Traits, DefaultQuirks> copier;
+    passed &= loadProgram(copier, workloadROM(Workload::MEMCOPY));
+    copier.run(200);
+    for (u32 i = 0; i < 224; i++)
+        passed &= copier.peek(0x400 + i) == copier.peek(PROGRAM_START + i);
+
+    // after n iterations smc's patched instruction is ADD V3/V4, n
+    Chip8Core<Chip8Traits, DefaultQuirks> patcher;
+    passed &= loadProgram(patcher, workloadROM(Workload::SELF_MODIFYING));
+    patcher.run(9 * 5);
+    passed &= patcher.peek(PROGRAM_START + 14) == 0x74 && patcher.peek(PROGRAM_START + 15) == 5;
+    passed &= patcher.registers().V[4] == 1 + 3 + 5 && patcher.registers().V[3] == 2 + 4;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void ASSEMBLER_TEST_SUITE()
+{
+    TEST_SUITE_START("Assembler");
+
+    testAssembler("sources assemble to the expected bytes, errors name the line");
+    testWorkloads("synthetic workloads are deterministic and do what they say");
+
+    TEST_SUITE_SUCCESS("Assembler");
+}
+
+// RND V0 0F, SKP V0, then a random key pressed or not adds to V1 and draws it
+static const char *keys_source = R"(
+loop:   RND V0, 0x0F
+        SKP V0
+        JP loop
+        ADD V1, V0
+        LD F, V1
+        DRW V0, V1, 5
+        JP loop
+)";
+
+// a different pad every frame, some of them empty
+static u16 movieKeys(u64 frame)
+{
+    return (u16)((frame * 40503u) >> 3) & (frame % 3 ? 0xFFFF : 0x0000);
+}
+
+// records frames [from, to) of chip8, hashes[i] is the state before frame i ran
+static void recordFrames(MovieWriter &writer, Chip8 &chip8, u64 from, u64 to, std::vector<u64> &hashes)
+{
+    hashes.resize(to + 1);
+    hashes[from] = chip8.fullStateHash();
+    for (u64 frame = from; frame < to; frame++)
+    {
+        writer.record(chip8, movieKeys(frame));
+        Movie::step(chip8, movieKeys(frame), CYCLES_PER_FRAME);
+        hashes[frame + 1] = chip8.fullStateHash();
+    }
+}
+
+static bool seeksTo(const Movie &movie, u64 frame, const std::vector<u64> &hashes)
+{
+    std::unique_ptr<Chip8> chip8 = createChip8(movie.variant(), movie.quirks());
+    return movie.seek(*chip8, frame) && chip8->fullStateHash() == hashes[frame];
+}
+
+void testMovieSeek(std::string test_name)
+{
+    bool passed = true;
+
+    // 4 chunks of 8 frames and 5 frames of the next one
+    const char *path = "core_test.c8m";
+    const u8 digest[SHA1_SIZE] = {1, 2, 3};
+    std::vector<u8> rom;
+    std::string error;
+    passed &= assemble(keys_source, rom, error);
+    std::unique_ptr<Chip8> chip8 = createChip8(Variant::SCHIP);
+    passed &= loadProgram(*chip8, rom);
+    std::vector<u64> hashes;
+    MovieWriter writer;
+    passed &= writer.open(path, *chip8, digest, CYCLES_PER_FRAME, 0, 8);
+    recordFrames(writer, *chip8, 0, 37, hashes);
+    writer.close();
+
+    // any frame is the straight replay's, keyframes and the end included
+    Movie movie;
+    passed &= movie.open(path) && movie.frames() == 37 && movie.variant() == Variant::SCHIP;
+    for (u64 frame : {0, 1, 7, 8, 9, 16, 23, 31, 32, 33, 36, 37})
+        passed &= seeksTo(movie, frame, hashes);
+    passed &= movie.keys(36) == movieKeys(36) && movie.keys(37) == 0;
+    std::unique_ptr<Chip8> other = createChip8(Variant::SCHIP);
+    passed &= !movie.seek(*other, 38);
+    movie.close();
+
+    // reopening appends from the end of the movie, past the next keyframe
+    passed &= writer.open(path, *chip8, digest, CYCLES_PER_FRAME, 0, 8) && writer.frames() == 37;
+    passed &= chip8->fullStateHash() == hashes[37];
+    recordFrames(writer, *chip8, 37, 50, hashes);
+    writer.close();
+    passed &= movie.open(path) && movie.frames() == 50;
+    for (u64 frame : {0, 36, 37, 39, 40, 41, 48, 49, 50})
+        passed &= seeksTo(movie, frame, hashes);
+    movie.close();
+
+    // the movie of another ROM isn't continued
+    const u8 other_digest[SHA1_SIZE] = {3, 2, 1};
+    passed &= !writer.open(path, *chip8, other_digest, CYCLES_PER_FRAME, 0, 8);
+    remove(path);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testMoviePartialChunks(std::string test_name)
+{
+    bool passed = true;
+
+    const char *path = "core_test.c8m";
+    const u8 digest[SHA1_SIZE] = {1, 2, 3};
+    std::vector<u8> rom;
+    std::string error;
+    passed &= assemble(keys_source, rom, error);
+    std::unique_ptr<Chip8> chip8 = createChip8(Variant::CHIP8);
+    passed &= loadProgram(*chip8, rom);
+    std::vector<u64> hashes;
+    MovieWriter writer;
+    passed &= writer.open(path, *chip8, digest, CYCLES_PER_FRAME, 0, 8);
+    recordFrames(writer, *chip8, 0, 36, hashes);
+    writer.close();
+
+    // header, then chunks of a keyframe and 8 keys
+    size_t state = chip8->stateSize(), chunk = state + 8 * sizeof(u16), header = 48;
+    Movie movie;
+
+    // a keyframe cut short is ignored, the previous one reaches the end
+    passed &= truncate(path, (off_t)(header + 4 * chunk + state / 2)) == 0;
+    passed &= movie.open(path) && movie.frames() == 32 && seeksTo(movie, 32, hashes);
+    movie.close();
+
+    // so is half a key, the frames before it are there
+    passed &= truncate(path, (off_t)(header + 3 * chunk + state + 5)) == 0;
+    passed &= movie.open(path) && movie.frames() == 26 && seeksTo(movie, 26, hashes) && seeksTo(movie, 24, hashes);
+    movie.close();
+
+    // recording resumes at the last complete frame and drops the rest
+    std::unique_ptr<Chip8> resumed = createChip8(Variant::CHIP8);
+    passed &= writer.open(path, *resumed, digest, CYCLES_PER_FRAME, 0, 8) && writer.frames() == 26;
+    recordFrames(writer, *resumed, 26, 34, hashes);
+    writer.close();
+    passed &= movie.open(path) && movie.frames() == 34;
+    for (u64 frame : {25, 26, 31, 32, 33, 34})
+        passed &= seeksTo(movie, frame, hashes);
+    movie.close();
+
+    // without its first keyframe a file isn't a movie, and isn't overwritten either
+    passed &= truncate(path, (off_t)(header + state - 1)) == 0;
+    passed &= !movie.open(path);
+    passed &= !writer.open(path, *resumed, digest, CYCLES_PER_FRAME, 0, 8);
+    FILE *file = fopen(path, "rb");
+    passed &= file != nullptr && fseek(file, 0, SEEK_END) == 0 && ftell(file) == (long)(header + state - 1);
+    if (file)
+        fclose(file);
+    remove(path);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void MOVIE_TEST_SUITE()
+{
+    TEST_SUITE_START("Input movies");
+
+    testMovieSeek("seeking a movie replays like the recording, appended or not");
+    testMoviePartialChunks("partial chunks are ignored and dropped when recording resumes");
+
+    TEST_SUITE_SUCCESS("Input movies");
+}
+
+static float indexReward(void *user, const chip8env *env, int index, uint8_t *done)
+{
+    (*(std::atomic<int> *)user)++;
+    return (float)index;
+}
+
+void testVecEnvLockstep(std::string test_name)
+{
+    bool passed = true;
+
+    // every machine of the env runs like one stepped on its own with the same seed and keys
+    std::vector<u8> rom;
+    std::string error;
+    passed &= assemble(keys_source, rom, error);
+    const int count = 6, frames_per_step = 3;
+    chip8env *env = chip8env_create(rom.data(), rom.size(), count, CHIP8ENV_SCHIP, CHIP8ENV_DEFAULT_QUIRKS,
+                                    frames_per_step, 0, 3, 100);
+    passed &= env != nullptr && chip8env_count(env) == count;
+    if (!env)
+    {
+        TEST_FAIL(test_name);
+        return;
+    }
+    std::atomic<int> calls(0);
+    chip8env_set_reward(env, indexReward, &calls);
+
+    std::vector<std::unique_ptr<Chip8>> serial;
+    for (int i = 0; i < count; i++)
+    {
+        serial.push_back(createChip8(Variant::SCHIP));
+        passed &= loadProgram(*serial[i], rom);
+        serial[i]->seed(100 + i);
+    }
+
+    std::vector<u8> observations(count * CHIP8ENV_WIDTH * CHIP8ENV_HEIGHT);
+    std::vector<float> rewards(count);
+    std::vector<u8> dones(count);
+    std::vector<u16> actions(count);
+    for (int step = 0; step < 40; step++)
+    {
+        for (int i = 0; i < count; i++)
+            actions[i] = movieKeys((u64)(step * count + i));
+        chip8env_step(env, actions.data(), observations.data(), rewards.data(), dones.data());
+        for (int i = 0; i < count; i++)
+        {
+            Chip8 &chip8 = *serial[i];
+            for (int f = 0; f < frames_per_step; f++)
+                Movie::step(chip8, actions[i], CYCLES_PER_FRAME);
+            for (int y = 0; y < CHIP8ENV_HEIGHT; y++)
+            {
+                for (int x = 0; x < CHIP8ENV_WIDTH; x++)
+                    passed &= observations[(i * CHIP8ENV_HEIGHT + y) * CHIP8ENV_WIDTH + x] == chip8.display.pixel(x, y);
+            }
+            for (u32 address = 0; address < MEMORY_SIZE; address++)
+                passed &= chip8env_peek(env, i, address) == chip8.peek(address);
+            for (int x = 0; x < 16; x++)
+                passed &= chip8env_register(env, i, x) == chip8.reg((u8)x);
+            passed &= rewards[i] == (float)i && dones[i] == 0;
+        }
+    }
+    passed &= calls == 40 * count;
+    chip8env_destroy(env);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testVecEnvEpisodes(std::string test_name)
+{
+    bool passed = true;
+
+    // key 0 down makes 00EE return with an empty stack, a stack fault
+    std::vector<u8> rom;
+    std::string error;
+    passed &= assemble("loop: SKP V0\n"
+                       "      JP loop\n"
+                       "      ADD V1, 1\n"
+                       "      RET\n",
+                       rom, error);
+    chip8env *env = chip8env_create(rom.data(), rom.size(), 2, CHIP8ENV_CHIP8, CHIP8ENV_DEFAULT_QUIRKS, 1, 0, 2, 0);
+    passed &= env != nullptr;
+    if (!env)
+    {
+        TEST_FAIL(test_name);
+        return;
+    }
+
+    // the fault ends machine 0's episode only
+    std::vector<u8> observations(2 * CHIP8ENV_WIDTH * CHIP8ENV_HEIGHT);
+    u8 dones[2];
+    u16 pressed[2] = {1, 0}, released[2] = {0, 0};
+    chip8env_step(env, pressed, observations.data(), nullptr, dones);
+    passed &= dones[0] == 1 && dones[1] == 0 && chip8env_register(env, 0, 1) == 1;
+
+    // the next step starts it over from the loaded ROM
+    chip8env_step(env, released, observations.data(), nullptr, dones);
+    passed &= dones[0] == 0 && dones[1] == 0 && chip8env_register(env, 0, 1) == 0;
+    chip8env_step(env, pressed, observations.data(), nullptr, dones);
+    passed &= dones[0] == 1 && chip8env_register(env, 0, 1) == 1;
+    chip8env_destroy(env);
+
+    // hires screens keep every other pixel of every other row
+    passed &= assemble("      HIGH\n"
+                       "      LD I, dot\n"
+                       "      LD V0, 2\n"
+                       "      LD V1, 2\n"
+                       "      DRW V0, V1, 1\n"
+                       "      LD V0, 5\n"
+                       "      LD V1, 5\n"
+                       "      DRW V0, V1, 1\n"
+                       "loop: JP loop\n"
+                       "dot:  DB 0x80\n",
+                       rom, error);
+    env = chip8env_create(rom.data(), rom.size(), 1, CHIP8ENV_SCHIP, CHIP8ENV_DEFAULT_QUIRKS, 1, 0, 1, 0);
+    passed &= env != nullptr;
+    if (env)
+    {
+        u16 none = 0;
+        chip8env_step(env, &none, observations.data(), nullptr, nullptr);
+        int lit = 0;
+        for (int p = 0; p < CHIP8ENV_WIDTH * CHIP8ENV_HEIGHT; p++)
+            lit += observations[p] != 0;
+        passed &= lit == 1 && observations[1 * CHIP8ENV_WIDTH + 1] == 1;
+        chip8env_destroy(env);
+    }
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void testThreadPool(std::string test_name)
+{
+    bool passed = true;
+
+    // every index runs exactly once per loop, loop after loop
+    ThreadPool pool(4);
+    passed &= pool.size() == 4;
+    for (int generation = 0; generation < 200; generation++)
+    {
+        int count = (generation * 37) % 101;
+        std::vector<std::atomic<int>> runs(count);
+        for (std::atomic<int> &run : runs)
+            run = 0;
+        pool.parallelFor(count, [&](int i) { runs[i]++; });
+        for (std::atomic<int> &run : runs)
+            passed &= run == 1;
+    }
+
+    // a pool of one runs everything on the caller
+    ThreadPool inline_pool(1);
+    std::thread::id caller = std::this_thread::get_id();
+    bool on_caller = true;
+    inline_pool.parallelFor(10, [&](int) { on_caller &= std::this_thread::get_id() == caller; });
+    passed &= inline_pool.size() == 1 && on_caller;
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void VEC_ENV_TEST_SUITE()
+{
+    TEST_SUITE_START("Vectorized environment");
+
+    testVecEnvLockstep("chip8env_step matches machines stepped one by one");
+    testVecEnvEpisodes("faults end episodes, restarts and hires observations");
+    testThreadPool("parallelFor runs every index once per loop");
+
+    TEST_SUITE_SUCCESS("Vectorized environment");
+}
+
+// random bits in both planes, every palette index shows up
+static void randomFrame(Frame &frame, u8 width, u8 height)
+{
+    u64 seed = 0x2545F4914F6CDD1Dull;
+    for (int p = 0; p < PLANES_COUNT; p++)
+    {
+        for (int y = 0; y < HIRES_HEIGHT; y++)
+        {
+            for (int w = 0; w < ROW_WORDS; w++)
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                frame.planes[p][y][w] = seed;
+            }
+        }
+    }
+    frame.width = width;
+    frame.height = height;
+}
+
+// both entry points of the kernel in use, pitch wider than the image so
+// nothing may be written past a row
+static void expandBoth(const Frame &frame, int scale, std::vector<u32> &packed, std::vector<u32> &indexed)
+{
+    static const u32 palette[4] = {0xFF000000, 0xFF00FF00, 0xFF008000, 0xFFB0FFB0};
+    int pitch = frame.width * scale + 5;
+    std::vector<u8> indices((size_t)frame.width * frame.height);
+    for (int y = 0; y < frame.height; y++)
+    {
+        for (int x = 0; x < frame.width; x++)
+            indices[(size_t)y * frame.width + x] = frame.pixel(x, y);
+    }
+    packed.assign((size_t)pitch * frame.height * scale, 0xDEADBEEF);
+    indexed.assign(packed.size(), 0xDEADBEEF);
+    expandFrame(frame, palette, scale, packed.data(), pitch);
+    expandIndices(indices.data(), frame.width, frame.height, palette, scale, indexed.data(), pitch);
+}
+
+void testExpandKernels(std::string test_name)
+{
+    bool passed = true;
+
+    // every kernel the cpu has writes what the scalar one does, lores and hires
+    ExpandKernel original = expandKernel();
+    Frame lores, hires;
+    randomFrame(lores, DISPLAY_WIDHT, DISPLAY_HEIGHT);
+    randomFrame(hires, HIRES_WIDTH, HIRES_HEIGHT);
+    for (const Frame *frame : {&lores, &hires})
+    {
+        for (int scale : {1, 3, 8})
+        {
+            std::vector<u32> packed, indexed, expected_packed, expected_indexed;
+            passed &= setExpandKernel(ExpandKernel::SCALAR);
+            expandBoth(*frame, scale, expected_packed, expected_indexed);
+            passed &= expected_packed == expected_indexed;
+            for (ExpandKernel kernel : {ExpandKernel::SSE2, ExpandKernel::AVX2})
+            {
+                if (!setExpandKernel(kernel))
+                    continue;
+                expandBoth(*frame, scale, packed, indexed);
+                passed &= packed == expected_packed && indexed == expected_indexed;
+            }
+        }
+    }
+    setExpandKernel(original);
+
+    if (passed)
+        TEST_PASS(test_name);
+    else
+        TEST_FAIL(test_name);
+}
+
+void EXPAND_TEST_SUITE()
+{
+    TEST_SUITE_START("Display expansion");
+
+    testExpandKernels("SIMD kernels expand frames like the scalar one");
+
+    TEST_SUITE_SUCCESS("Display expansion");
+}
+
+int main(int argc, char *argv[])
+{
+    LOADER_TEST_SUITE();
+    WAIT_KEY_TEST_SUITE();
+    SUPER_CHIP_TEST_SUITE();
+    XO_CHIP_TEST_SUITE();
+    QUIRKS_TEST_SUITE();
+    STATE_TEST_SUITE();
+    MEMORY_TEST_SUITE();
+    RUN_TEST_SUITE();
+    ASSEMBLER_TEST_SUITE();
+    MOVIE_TEST_SUITE();
+    VEC_ENV_TEST_SUITE();
+    EXPAND_TEST_SUITE();
+    return tests_failed;
+}
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "../include/chip8.h"
+#include "../include/expand.h"
+#include "../include/mapped_file.h"
+#include "../include/perf_counters.h"
+#include "../include/workloads.h"
+
+// bench: measures display expansion per frame with every kernel the cpu
+// supports, for lores/hires frames, packed or byte per pixel, at several
+// scales, then runs ROMs on every execution core with the host's hardware
+// counters, per emulated instruction and per frame
+//
+//   bench [options] [rom or workload...]
+//     -e <frames>                 frames per expansion measurement, 2000 by default
+//     -i <frames>                 frames each core runs, 100000 by default
+//     -c <cycles>                 instructions per frame, CYCLES_PER_FRAME by default
+//     -x                          skip the expansion kernels
+//
+// without a ROM the cores run every synthetic workload (workloads.h), a name
+// like "calls" runs one. counters the host refuses (no PMU in a VM,
+// perf_event_paranoid, not Linux) show as -
+
+static const u32 colors[4] = {0xFF000000, 0xFF00FF00, 0xFF008000, 0xFFB0FFB0};
+static const int bench_scales[] = {1, 2, 4, 8, 16};
+
+// half of the words set, like a busy game screen
+static void fillFrame(Frame &frame, u8 width, u8 height)
+{
+    u64 seed = 0x9E3779B97F4A7C15ull;
+    for (int p = 0; p < PLANES_COUNT; p++)
+    {
+        for (int y = 0; y < HIRES_HEIGHT; y++)
+        {
+            for (int w = 0; w < ROW_WORDS; w++)
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                frame.planes[p][y][w] = (seed & 1) ? seed : 0;
+            }
+        }
+    }
+    frame.width = width;
+    frame.height = height;
+}
+
+// variant and quirk profile of each core measured
+static const struct
+{
+    const char *name;
+    Variant variant;
+    QuirkProfile quirks;
+} bench_cores[] = {
+    {"chip8", Variant::CHIP8, QuirkProfile::DEFAULT},
+    {"vip", Variant::CHIP8, QuirkProfile::VIP},
+    {"vip-timed", Variant::CHIP8, QuirkProfile::VIP_TIMED},
+    {"schip", Variant::SCHIP, QuirkProfile::SCHIP},
+    {"xochip", Variant::XOCHIP, QuirkProfile::XOCHIP},
+};
+
+struct CoreRun
+{
+    u64 instructions;                           // emulated
+    u64 frames;
+    double ns;
+    u64 counts[(int)PerfCounter::COUNT];
+};
+
+// nanoseconds per frame, the output is read back so nothing is optimized out
+template <typename Expand>
+static double measure(int frames, Expand expand, std::vector<u32> &out)
+{
+    expand();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+        expand();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    volatile u32 sink = out[out.size() / 2];
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / frames;
+}
+
+// runs frames on a fresh core with the counters around the frame loop only,
+// false if the ROM doesn't fit or the core faults
+static bool runCore(const u8 *rom, size_t size, Variant variant, QuirkProfile quirks, u64 frames, int cycles,
+                    PerfCounters &counters, CoreRun &run)
+{
+    std::unique_ptr<Chip8> chip8 = createChip8(variant, quirks);
+    if (!chip8->loadROM(rom, size))
+        return false;
+
+    // a few frames first so the ROM, the core and the branch history are warm
+    for (int i = 0; i < TIMER_HZ; i++)
+    {
+        chip8->runFrame(cycles);
+        chip8->updateTimers();
+    }
+
+    run.instructions = 0;
+    run.frames = frames;
+    counters.start();
+    auto start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < frames; i++)
+    {
+        run.instructions += chip8->runFrame(cycles).cycles;
+        chip8->updateTimers();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    counters.stop();
+
+    run.ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    for (int c = 0; c < (int)PerfCounter::COUNT; c++)
+        run.counts[c] = counters.value((PerfCounter)c);
+    return chip8->fault() == Fault::NONE;
+}
+
+// one row per core, everything divided by per: emulated instructions or frames
+static void printRuns(const char *title, const std::vector<const char *> &names, const std::vector<CoreRun> &runs,
+                      bool per_frame, const PerfCounters &counters)
+{
+    printf("%s\n%-10s %12s", title, "core", per_frame ? "instrs" : "ns");
+    if (per_frame)
+        printf(" %12s", "ns");
+    for (int c = 0; c < (int)PerfCounter::COUNT; c++)
+        printf(" %14s", PerfCounters::name((PerfCounter)c));
+    printf("\n");
+
+    for (size_t r = 0; r < runs.size(); r++)
+    {
+        const CoreRun &run = runs[r];
+        double per = per_frame ? (double)run.frames : (double)(run.instructions ? run.instructions : 1);
+        printf("%-10s", names[r]);
+        if (per_frame)
+            printf(" %12.1f", run.instructions / per);
+        printf(" %12.2f", run.ns / per);
+        for (int c = 0; c < (int)PerfCounter::COUNT; c++)
+        {
+            if (counters.available((PerfCounter)c))
+                printf(" %14.2f", run.counts[c] / per);
+            else
+                printf(" %14s", "-");
+        }
+        printf("\n");
+    }
+}
+
+static void benchKernels(int frames)
+{
+    Frame lores, hires;
+    fillFrame(lores, DISPLAY_WIDHT, DISPLAY_HEIGHT);
+    fillFrame(hires, HIRES_WIDTH, HIRES_HEIGHT);
+    std::vector<u8> indices(HIRES_WIDTH * HIRES_HEIGHT);
+    for (int y = 0; y < HIRES_HEIGHT; y++)
+    {
+        for (int x = 0; x < HIRES_WIDTH; x++)
+            indices[y * HIRES_WIDTH + x] = hires.pixel(x, y);
+    }
+    std::vector<u32> out(HIRES_WIDTH * MAX_SCALE * HIRES_HEIGHT * MAX_SCALE);
+
+    ExpandKernel best = expandKernel();
+    printf("%-8s %6s %14s %14s %14s\n", "kernel", "scale", "lores ns", "hires ns", "bytes ns");
+    for (ExpandKernel kernel : {ExpandKernel::SCALAR, ExpandKernel::SSE2, ExpandKernel::AVX2})
+    {
+        if (!setExpandKernel(kernel))
+            continue;
+
+        for (int scale : bench_scales)
+        {
+            int pitch = HIRES_WIDTH * scale;
+            double lores_ns = measure(frames, [&] { expandFrame(lores, colors, scale, out.data(), DISPLAY_WIDHT * scale); }, out);
+            double hires_ns = measure(frames, [&] { expandFrame(hires, colors, scale, out.data(), pitch); }, out);
+            double bytes_ns = measure(frames, [&] { expandIndices(indices.data(), HIRES_WIDTH, HIRES_HEIGHT, colors, scale, out.data(), pitch); }, out);
+            printf("%-8s %6d %14.0f %14.0f %14.0f\n", expandKernelName(kernel), scale, lores_ns, hires_ns, bytes_ns);
+        }
+    }
+    setExpandKernel(best);
+    printf("default kernel: %s\n\n", expandKernelName(best));
+}
+
+// every core on one ROM, nothing is printed for the cores it faults on
+static void benchCores(const char *name, const u8 *rom, size_t size, u64 frames, int cycles, PerfCounters &counters)
+{
+    std::vector<const char *> names;
+    std::vector<CoreRun> runs;
+    for (const auto &core : bench_cores)
+    {
+        CoreRun run;
+        if (!runCore(rom, size, core.variant, core.quirks, frames, cycles, counters, run))
+        {
+            printf("[FAILED] %s faults or doesn't fit on %s\n", name, core.name);
+            continue;
+        }
+        names.push_back(core.name);
+        runs.push_back(run);
+    }
+
+    printf("%s, %llu frames of %d instructions\n", name, (unsigned long long)frames, cycles);
+    printRuns("per emulated instruction:", names, runs, false, counters);
+    printRuns("per frame:", names, runs, true, counters);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int expand_frames = 2000;
+    long long core_frames = 100000;
+    int cycles = CYCLES_PER_FRAME;
+    bool kernels = true;
+    bool usage = false;
+    std::vector<const char *> roms;
+    for (int i = 1; i < argc; i++)
+    {
+        bool value = i + 1 < argc;
+        if (strcmp(argv[i], "-e") == 0 && value)
+            expand_frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-i") == 0 && value)
+            core_frames = atoll(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && value)
+            cycles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-x") == 0)
+            kernels = false;
+        else if (argv[i][0] == '-')
+            usage = true;
+        else
+            roms.push_back(argv[i]);
+    }
+    if (usage || expand_frames < 1 || core_frames < 1 || cycles < 1)
+    {
+        std::fprintf(stderr, "usage: bench [-e frames] [-i frames] [-c cycles] [-x] [rom or workload...]\n");
+        return 1;
+    }
+
+    if (kernels)
+        benchKernels(expand_frames);
+
+    PerfCounters counters;
+    if (!counters.any())
+        printf("[FAILED] Hardware counters unavailable (%s), timing only\n\n", counters.error());
+    else if (counters.error())
+        printf("[PENDING] Some hardware counters unavailable (%s)\n\n", counters.error());
+
+    if (roms.empty())
+    {
+        for (int w = 0; w < (int)Workload::COUNT; w++)
+            roms.push_back(workloadName((Workload)w));
+    }
+    for (const char *path : roms)
+    {
+        Workload workload;
+        if (workloadFromName(path, workload))
+        {
+            std::vector<u8> rom = workloadROM(workload);
+            benchCores(path, rom.data(), rom.size(), (u64)core_frames, cycles, counters);
+            continue;
+        }
+
+        MappedFile rom;
+        if (!rom.open(path))
+        {
+            printf("[FAILED] Couldn't open %s\n", path);
+            continue;
+        }
+        benchCores(path, rom.data(), rom.size(), (u64)core_frames, cycles, counters);
+    }
+    return 0;
+}
\ No newline at end of file
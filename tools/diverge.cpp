@@ -0,0 +1,512 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "../include/chip8.h"
+#include "../include/mapped_file.h"
+#include "../include/movie.h"
+#include "../include/rom_database.h"
+#include "../include/sha1.h"
+
+// diverge: finds the first instruction where two runs of a ROM stop
+// agreeing, given the same keys every frame
+//
+//   diverge [options] <rom>
+//     -m <movie>                  keys of every frame from a movie recorded from the ROM's start, none without
+//     -n <frames>                 frames compared, the movie's length or 3600 by default
+//     -c <frames>                 frames between two checkpoints, 60 by default
+//     -v -q -i -e                 variant, quirks, instructions per frame and seed of run A
+//     -V -Q -I -E                 the same for run B, as A's by default
+//     -o <file>                   writes run A's checkpoints for comparing with another build
+//     -t <file>                   compares run A with checkpoints another build wrote with -o
+//     -w <frame>                  with -o and -t, every instruction of that frame too
+//
+// both runs go in lockstep and compare their state at every checkpoint,
+// saving it while they agree, so they stop at the first checkpoint they
+// disagree at. from the last one they agreed at, the frames up to it are
+// compared one by one, then the instructions of the first frame that
+// disagrees: the frame is run again from its start cut short after 1, 2,
+// ... instructions (Chip8::runFrame's limit) till the states differ. only
+// the window is run again, from the saved states.
+//
+// two builds can't run in one process, each writes or checks a file
+// instead. -c 1 finds the frame, -w <frame> then the instruction in it:
+//
+//   old/diverge -c 1 -o old.trace rom && new/diverge -c 1 -t old.trace rom
+//   old/diverge -c 1 -w 1234 -o old.trace rom && new/diverge -c 1 -w 1234 -t old.trace rom
+
+#define DIVERGE_FRAMES       3600               // one emulated minute
+#define DIVERGE_CHECKPOINTS  60                 // one emulated second
+#define PROBES_MAGIC         0x52503843         // "C8PR"
+#define PROBES_VERSION       1
+#define NO_FRAME             (~0ull)
+
+// one run's settings
+struct Config
+{
+    Variant variant;
+    QuirkProfile quirks;
+    int cycles_per_frame;
+    u64 seed;
+};
+
+// a run compared in this process
+struct Run
+{
+    Config config;
+    std::unique_ptr<Chip8> chip8;
+    std::vector<u8> saved;                      // state at the last point both runs agreed on
+};
+
+// a run's state at one point, instruction 0 being the start of the frame
+struct Probe
+{
+    u64 frame;
+    u64 hash;                                   // Chip8::stateHash()
+    u32 instruction;
+    u16 pc;
+    u16 opcode;
+    u16 index;
+    u8 sp;
+    u8 delay_timer;
+    u8 sound_timer;
+    u8 V[16];
+    u8 reserved[3];
+};
+
+// probe files are read back as is
+static_assert(sizeof(Probe) == 48, "unexpected Probe padding");
+
+struct ProbesHeader
+{
+    u32 magic;
+    u32 version;
+    u8 digest[SHA1_SIZE];                       // SHA-1 of the ROM
+    u32 every;                                  // -c
+    u64 window;                                 // -w, NO_FRAME without
+    u64 count;
+};
+
+static_assert(sizeof(ProbesHeader) == 48, "unexpected ProbesHeader padding");
+
+static const char *option(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+    }
+    return nullptr;
+}
+
+// -v -q -i -e, or -V -Q -I -E falling back on run A's settings
+static bool parseConfig(int argc, char *argv[], const char *names, const Config &fallback, Config &config)
+{
+    char name[3] = {'-', 0, 0};
+    config = fallback;
+    name[1] = names[0];
+    if (option(argc, argv, name))
+    {
+        if (!variantFromName(option(argc, argv, name), config.variant))
+            return false;
+        config.quirks = defaultQuirks(config.variant);
+    }
+    name[1] = names[1];
+    if (option(argc, argv, name) && !quirksFromName(option(argc, argv, name), config.quirks))
+        return false;
+    name[1] = names[2];
+    if (option(argc, argv, name))
+        config.cycles_per_frame = atoi(option(argc, argv, name));
+    name[1] = names[3];
+    if (option(argc, argv, name))
+        config.seed = strtoull(option(argc, argv, name), nullptr, 0);
+    return true;
+}
+
+static Probe probe(Chip8 &chip8, u64 frame, u32 instruction)
+{
+    Probe probe;
+    memset(&probe, 0, sizeof(probe));
+    Registers registers = chip8.registers();
+    probe.frame = frame;
+    probe.hash = chip8.stateHash();
+    probe.instruction = instruction;
+    probe.pc = registers.pc;
+    probe.opcode = registers.opcode;
+    probe.index = registers.index;
+    probe.sp = registers.sp;
+    probe.delay_timer = registers.delay_timer;
+    probe.sound_timer = registers.sound_timer;
+    memcpy(probe.V, registers.V, sizeof(probe.V));
+    return probe;
+}
+
+static bool sameProbe(const Probe &a, const Probe &b)
+{
+    return memcmp(&a, &b, sizeof(Probe)) == 0;
+}
+
+// one frame with the keys recorded for it, cut short after limit instructions
+static RunResult runFrame(Chip8 &chip8, const Config &config, const Movie *movie, u64 frame, u32 limit = UINT32_MAX)
+{
+    u16 keys = movie ? movie->keys(frame) : 0;
+    for (int k = 0; k < KEYPAD_SIZE; k++)
+        chip8.keypad[k] = (keys >> k) & 1u;
+    RunResult result = chip8.runFrame(config.cycles_per_frame, limit);
+    if (limit == UINT32_MAX)
+        chip8.updateTimers();
+    return result;
+}
+
+static std::unique_ptr<Chip8> boot(const Config &config, const u8 *rom, size_t size)
+{
+    std::unique_ptr<Chip8> chip8 = createChip8(config.variant, config.quirks);
+    chip8->seed(config.seed);
+    chip8->loadROM(rom, size);
+    return chip8;
+}
+
+// run A for a probe file: frames [0, end) from the ROM's start, probing the start of every
+// every-th frame and of frame end, and after each instruction of the frame
+// window. the probes are in the order of the run
+static std::vector<Probe> trace(const Config &config, const u8 *rom, size_t size, const Movie *movie, u64 end,
+                                u64 every, u64 window)
+{
+    std::vector<Probe> probes;
+    std::unique_ptr<Chip8> chip8 = boot(config, rom, size);
+    std::vector<u8> start(chip8->stateSize());
+    for (u64 frame = 0; frame < end; frame++)
+    {
+        if (frame % every == 0)
+            probes.push_back(probe(*chip8, frame, 0));
+        if (frame == window)
+        {
+            chip8->saveState(start.data());
+            u32 count = runFrame(*chip8, config, movie, frame).cycles;
+            for (u32 i = 1; i <= count; i++)
+            {
+                chip8->loadState(start.data(), start.size());
+                runFrame(*chip8, config, movie, frame, i);
+                probes.push_back(probe(*chip8, frame, i));
+            }
+            chip8->loadState(start.data(), start.size());
+        }
+        runFrame(*chip8, config, movie, frame);
+    }
+    probes.push_back(probe(*chip8, end, 0));
+    return probes;
+}
+
+// runs both machines from frame begin to frame end, probing the start of
+// every every-th frame and of frame end. each probe both runs agree on is
+// saved, the machines are left where they first disagree. returns that
+// probe's frame, NO_FRAME if they agree all along. agreed counts the
+// probes they agreed on, last is the frame of the last one
+static u64 compare(Run &a, Run &b, const Movie *movie, u64 begin, u64 end, u64 every, Probe &probe_a,
+                   Probe &probe_b, u64 &agreed, u64 &last)
+{
+    agreed = 0;
+    last = begin;
+    for (u64 frame = begin;; frame++)
+    {
+        if ((frame - begin) % every == 0 || frame == end)
+        {
+            probe_a = probe(*a.chip8, frame, 0);
+            probe_b = probe(*b.chip8, frame, 0);
+            if (!sameProbe(probe_a, probe_b))
+                return frame;
+            a.chip8->saveState(a.saved.data());
+            b.chip8->saveState(b.saved.data());
+            agreed++;
+            last = frame;
+        }
+        if (frame == end)
+            return NO_FRAME;
+        runFrame(*a.chip8, a.config, movie, frame);
+        runFrame(*b.chip8, b.config, movie, frame);
+    }
+}
+
+// the run's frame from its saved start cut short after instruction i, the
+// start of the next frame if the frame ends before that
+static Probe stepTo(Run &run, const Movie *movie, u64 frame, u32 i)
+{
+    run.chip8->loadState(run.saved.data(), run.saved.size());
+    if (runFrame(*run.chip8, run.config, movie, frame, i).cycles == i)
+        return probe(*run.chip8, frame, i);
+    run.chip8->updateTimers();
+    return probe(*run.chip8, frame + 1, 0);
+}
+
+// index of the first probe the runs disagree on, the shorter length if none
+static size_t firstMismatch(const std::vector<Probe> &a, const std::vector<Probe> &b)
+{
+    size_t count = std::min(a.size(), b.size());
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!sameProbe(a[i], b[i]))
+            return i;
+    }
+    return count;
+}
+
+static void printWhere(const Probe &probe)
+{
+    if (probe.instruction)
+        printf("frame %llu, instruction %u", (unsigned long long)probe.frame, probe.instruction);
+    else
+        printf("the start of frame %llu", (unsigned long long)probe.frame);
+}
+
+// what the two probes disagree on, the machines add memory and the display when both are there
+static void printDifference(const Probe &a, const Probe &b, const Probe *before, Chip8 *chip_a, Chip8 *chip_b)
+{
+    printf("[FAILED] The runs diverge at ");
+    printWhere(a);
+    printf("\n");
+    if (a.instruction != b.instruction || a.frame != b.frame)
+    {
+        printf("         run B is at ");
+        printWhere(b);
+        printf(", its frame ended after another number of instructions\n");
+        return;
+    }
+    if (a.instruction && before)
+    {
+        printf("         pc 0x%03X opcode %04X", before->pc, a.opcode);
+        if (a.opcode != b.opcode)
+            printf(" in run A, opcode %04X in run B", b.opcode);
+        printf("\n");
+    }
+
+    if (a.pc != b.pc)
+        printf("         pc: 0x%03X / 0x%03X\n", a.pc, b.pc);
+    if (a.index != b.index)
+        printf("         I: 0x%03X / 0x%03X\n", a.index, b.index);
+    if (a.sp != b.sp)
+        printf("         sp: %u / %u\n", a.sp, b.sp);
+    if (a.delay_timer != b.delay_timer)
+        printf("         delay timer: %u / %u\n", a.delay_timer, b.delay_timer);
+    if (a.sound_timer != b.sound_timer)
+        printf("         sound timer: %u / %u\n", a.sound_timer, b.sound_timer);
+    for (int x = 0; x < 16; x++)
+    {
+        if (a.V[x] != b.V[x])
+            printf("         V%X: 0x%02X / 0x%02X\n", x, a.V[x], b.V[x]);
+    }
+    if (a.hash == b.hash)
+        return;
+
+    // the hash covers what the registers above don't
+    bool found = false;
+    if (chip_a && chip_b)
+    {
+        u32 memory_a = chip_a->variant() == Variant::XOCHIP ? XO_MEMORY_SIZE : MEMORY_SIZE;
+        u32 memory_b = chip_b->variant() == Variant::XOCHIP ? XO_MEMORY_SIZE : MEMORY_SIZE;
+        if (memory_a != memory_b)
+        {
+            printf("         memory size: %u / %u bytes\n", memory_a, memory_b);
+            found = true;
+        }
+        u32 memory = std::min(memory_a, memory_b);
+        for (u32 address = 0; address < memory; address++)
+        {
+            if (chip_a->peek(address) != chip_b->peek(address))
+            {
+                printf("         memory 0x%04X: 0x%02X / 0x%02X\n", address, chip_a->peek(address),
+                       chip_b->peek(address));
+                found = true;
+                break;
+            }
+        }
+        if (memcmp(chip_a->display.planes, chip_b->display.planes, sizeof(chip_a->display.planes)) != 0 ||
+            chip_a->display.width != chip_b->display.width)
+        {
+            printf("         display\n");
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        printf("         state hash: %016llx / %016llx (%s)\n", (unsigned long long)a.hash, (unsigned long long)b.hash,
+               chip_a ? "the stack, a pending FX0A or vblank, the cycle budget or the random generator"
+                      : "memory, the display or the rest of the state");
+    }
+}
+
+static bool writeProbes(const char *path, const u8 digest[SHA1_SIZE], u64 every, u64 window,
+                        const std::vector<Probe> &probes)
+{
+    ProbesHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PROBES_MAGIC;
+    header.version = PROBES_VERSION;
+    memcpy(header.digest, digest, SHA1_SIZE);
+    header.every = (u32)every;
+    header.window = window;
+    header.count = probes.size();
+
+    FILE *out = fopen(path, "wb");
+    if (!out)
+        return false;
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   fwrite(probes.data(), sizeof(Probe), probes.size(), out) == probes.size();
+    return (fclose(out) == 0) && written;
+}
+
+static bool readProbes(const char *path, const u8 digest[SHA1_SIZE], u64 every, u64 window, std::vector<Probe> &probes)
+{
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(ProbesHeader))
+        return false;
+    const ProbesHeader *header = (const ProbesHeader *)file.data();
+    if (header->magic != PROBES_MAGIC || header->version != PROBES_VERSION ||
+        file.size() != sizeof(ProbesHeader) + header->count * sizeof(Probe) ||
+        memcmp(header->digest, digest, SHA1_SIZE) != 0 || header->every != every || header->window != window)
+    {
+        return false;
+    }
+    probes.resize(header->count);
+    memcpy(probes.data(), file.data() + sizeof(ProbesHeader), header->count * sizeof(Probe));
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argv[argc - 1][0] == '-')
+    {
+        fprintf(stderr, "usage: diverge [-m movie] [-n frames] [-c frames] [-v variant] [-q quirks] [-i cycles] [-e seed] "
+                        "[-V variant] [-Q quirks] [-I cycles] [-E seed] [-o file | -t file] [-w frame] <rom>\n");
+        return 1;
+    }
+
+    Config defaults = {Variant::CHIP8, defaultQuirks(Variant::CHIP8), CYCLES_PER_FRAME, RNG_DEFAULT_SEED};
+    Config a, b;
+    if (!parseConfig(argc, argv, "vqie", defaults, a) || !parseConfig(argc, argv, "VQIE", a, b))
+    {
+        fprintf(stderr, "[FAILED] Unknown variant or quirk profile\n");
+        return 1;
+    }
+
+    MappedFile rom;
+    if (!rom.open(argv[argc - 1]))
+    {
+        fprintf(stderr, "[FAILED] Could't Load the ROM\n");
+        return 1;
+    }
+    u8 digest[SHA1_SIZE];
+    sha1(rom.data(), rom.size(), digest);
+
+    Movie movie;
+    const Movie *keys = nullptr;
+    if (option(argc, argv, "-m"))
+    {
+        if (!movie.open(option(argc, argv, "-m")))
+        {
+            fprintf(stderr, "[FAILED] %s isn't a movie\n", option(argc, argv, "-m"));
+            return 1;
+        }
+        if (memcmp(movie.digest(), digest, SHA1_SIZE) != 0)
+            fprintf(stderr, "[FAILED] The movie was recorded with another ROM, replaying its keys anyway\n");
+        keys = &movie;
+    }
+
+    u64 frames = keys ? keys->frames() : DIVERGE_FRAMES;
+    if (option(argc, argv, "-n"))
+        frames = strtoull(option(argc, argv, "-n"), nullptr, 0);
+    u64 every = option(argc, argv, "-c") ? std::max(1ull, strtoull(option(argc, argv, "-c"), nullptr, 0))
+                                         : DIVERGE_CHECKPOINTS;
+    u64 window = option(argc, argv, "-w") ? strtoull(option(argc, argv, "-w"), nullptr, 0) : NO_FRAME;
+
+    // another build's run: written as is, or read back in place of run B
+    std::vector<Probe> probes_a;
+    if (option(argc, argv, "-o") || option(argc, argv, "-t"))
+        probes_a = trace(a, rom.data(), rom.size(), keys, frames, every, window);
+    if (option(argc, argv, "-o"))
+    {
+        if (!writeProbes(option(argc, argv, "-o"), digest, every, window, probes_a))
+        {
+            fprintf(stderr, "[FAILED] Couldn't write %s\n", option(argc, argv, "-o"));
+            return 1;
+        }
+        printf("[OK] %zu probes of %llu frames written to %s\n", probes_a.size(), (unsigned long long)frames,
+               option(argc, argv, "-o"));
+        return 0;
+    }
+    if (option(argc, argv, "-t"))
+    {
+        std::vector<Probe> probes_b;
+        if (!readProbes(option(argc, argv, "-t"), digest, every, window, probes_b))
+        {
+            fprintf(stderr, "[FAILED] %s wasn't written with -o for this ROM, -c and -w\n", option(argc, argv, "-t"));
+            return 1;
+        }
+        size_t first = firstMismatch(probes_a, probes_b);
+        if (first == probes_a.size() && probes_a.size() == probes_b.size())
+        {
+            printf("[OK] The builds agree on all %zu probes\n", probes_a.size());
+            return 0;
+        }
+        if (first == std::min(probes_a.size(), probes_b.size()))
+        {
+            printf("[FAILED] The builds ran different numbers of frames\n");
+            return 1;
+        }
+
+        // only this build's machine can be rebuilt, memory can't be compared
+        const Probe *before = first ? &probes_a[first - 1] : nullptr;
+        printDifference(probes_a[first], probes_b[first], before, nullptr, nullptr);
+        if (probes_a[first].instruction)
+            return 1;
+        if (every > 1)
+            printf("         rerun both builds with -c 1 for the frame\n");
+        else if (probes_a[first].frame > 0)
+            printf("         rerun both builds with -c 1 -w %llu for the instruction\n",
+                   (unsigned long long)(probes_a[first].frame - 1));
+        return 1;
+    }
+
+    // the checkpoint both runs first disagree on
+    Run run_a = {a, boot(a, rom.data(), rom.size()), {}};
+    Run run_b = {b, boot(b, rom.data(), rom.size()), {}};
+    run_a.saved.resize(run_a.chip8->stateSize());
+    run_b.saved.resize(run_b.chip8->stateSize());
+    Probe probe_a, probe_b;
+    u64 agreed, last;
+    u64 end = compare(run_a, run_b, keys, 0, frames, every, probe_a, probe_b, agreed, last);
+    if (end == NO_FRAME)
+    {
+        printf("[OK] The runs agree on all %llu checkpoints of %llu frames\n", (unsigned long long)agreed,
+               (unsigned long long)frames);
+        return 0;
+    }
+    printf("[OK] %llu checkpoints agree\n", (unsigned long long)agreed);
+    if (agreed == 0)
+    {
+        printDifference(probe_a, probe_b, nullptr, run_a.chip8.get(), run_b.chip8.get());
+        return 1;
+    }
+
+    // then the frame, every frame from the last checkpoint both agree on is
+    // probed. the state saved last is the start of the frame that diverges
+    run_a.chip8->loadState(run_a.saved.data(), run_a.saved.size());
+    run_b.chip8->loadState(run_b.saved.data(), run_b.saved.size());
+    compare(run_a, run_b, keys, last, end, 1, probe_a, probe_b, agreed, last);
+    u64 frame = last;
+
+    // and the instruction, the frame is probed after each one
+    run_a.chip8->loadState(run_a.saved.data(), run_a.saved.size());
+    Probe before = probe(*run_a.chip8, frame, 0);
+    for (u32 i = 1;; i++)
+    {
+        probe_a = stepTo(run_a, keys, frame, i);
+        probe_b = stepTo(run_b, keys, frame, i);
+        if (!sameProbe(probe_a, probe_b) || probe_a.instruction == 0)
+            break;
+        before = probe_a;
+    }
+    printDifference(probe_a, probe_b, &before, run_a.chip8.get(), run_b.chip8.get());
+    return 1;
+}
\ No newline at end of file
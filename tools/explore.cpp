@@ -0,0 +1,313 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include "../include/chip8.h"
+#include "../include/rom_database.h"
+#include "../include/thread_pool.h"
+
+// explore: breadth-first search over keypad inputs from a starting state,
+// every state reached is deduplicated by Chip8::stateHash()
+//
+//   explore [options] <rom>
+//     -v <variant> -q <quirks>    machine, as for the emulator
+//     -w <frames>                 frames run with no key before searching, 0 by default
+//     -s <state>                  start from a file holding a Chip8::saveState() buffer instead
+//     -f <frames>                 frames each input is held for, 4 by default
+//     -d <depth>                  inputs deep, 8 by default
+//     -b <hex address>            stop at the first input sequence taking pc there
+//     -m <states>                 visited set capacity, 4M by default
+//     -j <threads>                0 for every hardware thread
+//
+// an input is no key or one of the 16 keys, so each state has 17 successors.
+// a frontier takes stateSize() bytes per state, 6KB on CHIP-8.
+
+#define INPUTS          (KEYPAD_SIZE + 1)       // no key, then keys 0-F
+#define NO_KEY          0
+
+// open addressing set of 64-bit hashes shared by every thread, inserting
+// takes one compare and swap and never blocks. hash 0 marks empty slots so
+// it's stored as 1, a collision costing at worst a state wrongly skipped
+class VisitedSet
+{
+public:
+    explicit VisitedSet(size_t capacity)
+        : slots(roundUp(capacity * 2)), mask(slots.size() - 1), limit(capacity), count(0)
+    {
+    }
+
+    // true if the hash wasn't there, false if it was or the set is full
+    bool insert(u64 hash)
+    {
+        if (!hash)
+            hash = 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask)
+        {
+            u64 seen = slots[i].load(std::memory_order_relaxed);
+            if (seen == hash)
+                return false;
+            if (seen)
+                continue;
+            if (count.load(std::memory_order_relaxed) >= limit)
+                return false;
+            if (slots[i].compare_exchange_strong(seen, hash, std::memory_order_relaxed))
+            {
+                count.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (seen == hash)
+                return false;
+        }
+    }
+
+    size_t size() const
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    bool full() const
+    {
+        return size() >= limit;
+    }
+
+private:
+    static size_t roundUp(size_t n)
+    {
+        size_t power = 1;
+        while (power < n)
+            power <<= 1;
+        return power;
+    }
+
+    std::vector<std::atomic<u64>> slots;
+    size_t mask;
+    size_t limit;                               // half the slots, probes stay short
+    std::atomic<size_t> count;
+};
+
+// states of one depth, the inputs that led to each stored next to it
+struct Frontier
+{
+    std::vector<u8> states;                     // count * state_size
+    std::vector<u8> paths;                      // count * depth inputs
+    size_t count = 0;
+
+    void append(const Frontier &other)
+    {
+        states.insert(states.end(), other.states.begin(), other.states.end());
+        paths.insert(paths.end(), other.paths.begin(), other.paths.end());
+        count += other.count;
+    }
+};
+
+static const char *option(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+    }
+    return nullptr;
+}
+
+static long number(int argc, char *argv[], const char *name, long fallback)
+{
+    return option(argc, argv, name) ? atol(option(argc, argv, name)) : fallback;
+}
+
+static void printPath(const u8 *path, int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        if (path[i] == NO_KEY)
+            printf(" -");
+        else
+            printf(" %X", path[i] - 1);
+    }
+    printf("\n");
+}
+
+static bool readFile(const char *path, std::vector<u8> &data)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    u8 chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + count);
+    fclose(file);
+    return true;
+}
+
+// runs state with input held for hold frames, true if it faulted.
+// reached is set when the breakpoint stopped one of the frames
+static bool holdInput(Chip8 &chip8, const u8 *state, size_t state_size, int input, int hold, bool &reached)
+{
+    chip8.loadState(state, state_size);
+    for (int k = 0; k < KEYPAD_SIZE; k++)
+        chip8.keypad[k] = (input == k + 1);
+    for (int f = 0; f < hold; f++)
+    {
+        RunResult result = chip8.runFrame(CYCLES_PER_FRAME);
+        chip8.updateTimers();
+        reached |= result.reason == StopReason::BREAKPOINT;
+        if (result.reason == StopReason::STACK_FAULT || result.reason == StopReason::ILLEGAL_OPCODE)
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argv[argc - 1][0] == '-')
+    {
+        fprintf(stderr, "usage: explore [-v variant] [-q quirks] [-w frames] [-s state] [-f frames] [-d depth] "
+                        "[-b address] [-m states] [-j threads] <rom>\n");
+        return 1;
+    }
+
+    Variant variant = Variant::CHIP8;
+    if (option(argc, argv, "-v") && !variantFromName(option(argc, argv, "-v"), variant))
+    {
+        fprintf(stderr, "[FAILED] Unknown variant %s\n", option(argc, argv, "-v"));
+        return 1;
+    }
+    QuirkProfile quirks = defaultQuirks(variant);
+    if (option(argc, argv, "-q") && !quirksFromName(option(argc, argv, "-q"), quirks))
+    {
+        fprintf(stderr, "[FAILED] Unknown quirk profile %s\n", option(argc, argv, "-q"));
+        return 1;
+    }
+    int hold = (int)number(argc, argv, "-f", 4);
+    int depth = (int)number(argc, argv, "-d", 8);
+    u32 target = option(argc, argv, "-b") ? (u32)strtoul(option(argc, argv, "-b"), nullptr, 16) : NO_BREAKPOINT;
+
+    // the starting state, after the warm up frames or from a file
+    std::unique_ptr<Chip8> start = createChip8(variant, quirks);
+    if (!start->loadROM(argv[argc - 1]))
+    {
+        fprintf(stderr, "[FAILED] Could't Load the ROM\n");
+        return 1;
+    }
+    for (long i = number(argc, argv, "-w", 0); i > 0; i--)
+    {
+        start->runFrame(CYCLES_PER_FRAME);
+        start->updateTimers();
+    }
+    if (option(argc, argv, "-s"))
+    {
+        std::vector<u8> state;
+        if (!readFile(option(argc, argv, "-s"), state) || !start->loadState(state.data(), state.size()))
+        {
+            fprintf(stderr, "[FAILED] %s isn't a state of this machine\n", option(argc, argv, "-s"));
+            return 1;
+        }
+    }
+
+    size_t state_size = start->stateSize();
+    VisitedSet visited((size_t)number(argc, argv, "-m", 1l << 22));
+    visited.insert(start->stateHash());
+    Frontier frontier;
+    frontier.states.resize(state_size);
+    start->saveState(frontier.states.data());
+    frontier.count = 1;
+
+    // one machine and one output frontier per task, task t expands the
+    // states t, t + tasks, t + 2 * tasks ...
+    ThreadPool pool((int)number(argc, argv, "-j", 0));
+    int tasks = pool.size();
+    std::vector<std::unique_ptr<Chip8>> machines;
+    for (int t = 0; t < tasks; t++)
+    {
+        machines.push_back(createChip8(variant, quirks));
+        machines.back()->setBreakpoint(target);
+    }
+
+    std::mutex found_mutex;
+    std::vector<u8> found;                      // inputs reaching the target, empty till then
+    std::atomic<u64> faults{0};
+    u64 successors = 0;
+    auto began = std::chrono::steady_clock::now();
+
+    printf("[OK] %zu bytes per state, %d threads\n", state_size, tasks);
+    for (int level = 0; level < depth && found.empty() && frontier.count && !visited.full(); level++)
+    {
+        auto level_began = std::chrono::steady_clock::now();
+        std::vector<Frontier> next(tasks);
+        pool.parallelFor(tasks, [&](int t) {
+            Chip8 &chip8 = *machines[t];
+            Frontier &out = next[t];
+            std::vector<u8> path(level + 1);
+            for (size_t n = t; n < frontier.count; n += tasks)
+            {
+                const u8 *state = frontier.states.data() + n * state_size;
+                memcpy(path.data(), frontier.paths.data() + n * level, level);
+                for (int input = 0; input < INPUTS; input++)
+                {
+                    path[level] = (u8)input;
+
+                    // held for the whole step, a fault makes it a dead end. a
+                    // breakpoint cuts its frame short, so once the target is
+                    // found the input runs again without it for the real state
+                    bool reached = false;
+                    bool dead = holdInput(chip8, state, state_size, input, hold, reached);
+                    if (reached)
+                    {
+                        {
+                            std::lock_guard<std::mutex> lock(found_mutex);
+                            if (found.empty())
+                                found = path;
+                        }
+                        chip8.setBreakpoint(NO_BREAKPOINT);
+                        dead = holdInput(chip8, state, state_size, input, hold, reached);
+                        chip8.setBreakpoint(target);
+                    }
+                    if (dead)
+                    {
+                        faults.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    if (!visited.insert(chip8.stateHash()))
+                        continue;
+
+                    size_t at = out.states.size();
+                    out.states.resize(at + state_size);
+                    chip8.saveState(out.states.data() + at);
+                    out.paths.insert(out.paths.end(), path.begin(), path.end());
+                    out.count++;
+                }
+            }
+        });
+
+        size_t expanded = frontier.count;
+        frontier = Frontier();
+        for (Frontier &part : next)
+            frontier.append(part);
+        successors += expanded * INPUTS;
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - level_began).count();
+        printf("[OK] depth %d: %zu states expanded, %zu new, %zu visited, %.0f states/s\n", level + 1, expanded,
+               frontier.count, visited.size(), seconds > 0 ? expanded * INPUTS / seconds : 0.0);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+    printf("[OK] %llu states stepped in %.3fs, %.0f states/s, %llu faulted\n", (unsigned long long)successors,
+           seconds, seconds > 0 ? successors / seconds : 0.0, (unsigned long long)faults.load());
+    if (visited.full())
+        printf("[FAILED] The visited set is full, pass a larger -m\n");
+    if (target != NO_BREAKPOINT)
+    {
+        if (found.empty())
+        {
+            printf("[FAILED] 0x%03X wasn't reached\n", target);
+            return 1;
+        }
+        printf("[OK] 0x%03X reached with the inputs:", target);
+        printPath(found.data(), (int)found.size());
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/assembler.h"
+#include "../include/workloads.h"
+
+// genrom: writes the synthetic workload ROMs and assembles CHIP-8 sources
+//
+//   genrom list                       print the workloads and their sizes
+//   genrom write <dir> [workload...]  write <dir>/<workload>.ch8, every workload by default
+//   genrom source <workload>          print the assembly of a workload
+//   genrom asm <source> <rom>         assemble a source file, syntax in include/assembler.h
+
+static bool writeFile(const std::string &path, const std::vector<u8> &rom)
+{
+    std::ofstream out(path, std::ios::binary);
+    out.write((const char *)rom.data(), (std::streamsize)rom.size());
+    return out.good();
+}
+
+static int write(const char *dir, const std::vector<Workload> &selected)
+{
+    for (Workload workload : selected)
+    {
+        std::string path = std::string(dir) + "/" + workloadName(workload) + ".ch8";
+        if (!writeFile(path, workloadROM(workload)))
+        {
+            std::cerr << "[FAILED] Couldn't write " << path << "\n";
+            return 1;
+        }
+        std::cout << "[OK] " << path << "\n";
+    }
+    return 0;
+}
+
+static int assembleFile(const char *source_path, const char *rom_path)
+{
+    std::ifstream in(source_path);
+    if (!in.is_open())
+    {
+        std::cerr << "[FAILED] Couldn't open " << source_path << "\n";
+        return 1;
+    }
+    std::stringstream source;
+    source << in.rdbuf();
+
+    std::vector<u8> rom;
+    std::string error;
+    if (!assemble(source.str(), rom, error))
+    {
+        std::cerr << "[FAILED] " << source_path << ": " << error << "\n";
+        return 1;
+    }
+    if (!writeFile(rom_path, rom))
+    {
+        std::cerr << "[FAILED] Couldn't write " << rom_path << "\n";
+        return 1;
+    }
+    std::cout << "[OK] " << rom.size() << " bytes written to " << rom_path << "\n";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 2 && strcmp(argv[1], "list") == 0)
+    {
+        for (int w = 0; w < (int)Workload::COUNT; w++)
+            printf("%-10s %4zu bytes\n", workloadName((Workload)w), workloadROM((Workload)w).size());
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "write") == 0)
+    {
+        std::vector<Workload> selected;
+        for (int i = 3; i < argc; i++)
+        {
+            Workload workload;
+            if (!workloadFromName(argv[i], workload))
+            {
+                std::cerr << "[FAILED] Unknown workload " << argv[i] << "\n";
+                return 1;
+            }
+            selected.push_back(workload);
+        }
+        if (selected.empty())
+        {
+            for (int w = 0; w < (int)Workload::COUNT; w++)
+                selected.push_back((Workload)w);
+        }
+        return write(argv[2], selected);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "source") == 0)
+    {
+        Workload workload;
+        if (!workloadFromName(argv[2], workload))
+        {
+            std::cerr << "[FAILED] Unknown workload " << argv[2] << "\n";
+            return 1;
+        }
+        printf("%s", workloadSource(workload));
+        return 0;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "asm") == 0)
+    {
+        return assembleFile(argv[2], argv[3]);
+    }
+
+    std::cerr << "usage: genrom list\n"
+              << "       genrom write <dir> [workload...]\n"
+              << "       genrom source <workload>\n"
+              << "       genrom asm <source> <rom>\n";
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/rom_database.h"
+
+// romdb: builds and queries the ROM index used by the emulator
+//
+//   romdb hash <rom>...              print the SHA-1 of each ROM
+//   romdb build <list.txt> <out.db>  build an index from a text list
+//   romdb find <index.db> <rom>...   print the settings stored for each ROM
+//
+// list lines: <sha1> <chip8|schip|xochip> <default|vip|schip|xochip|vip-timed> <cycles per frame> [keymap]
+// keymap is 16 hex digits, digit i is the chip-8 key driven by the host key of keypad i.
+// everything after a # is a comment.
+
+static const char *variant_names[] = {"chip8", "schip", "xochip"};
+static const char *quirks_names[] = {"default", "vip", "schip", "xochip", "vip-timed"};
+
+static bool hashFile(const char *path, u8 digest[SHA1_SIZE])
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+    sha1(file.data(), file.size(), digest);
+    return true;
+}
+
+static int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseLine(const std::string &line, RomEntry &entry)
+{
+    std::istringstream in(line);
+    std::string hash, variant, quirks, keymap;
+    int cycles = 0;
+    if (!(in >> hash >> variant >> quirks >> cycles) || hash.size() != 2 * SHA1_SIZE || cycles <= 0 ||
+        cycles > UINT16_MAX)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < SHA1_SIZE; i++)
+    {
+        int hi = hexDigit(hash[2 * i]), lo = hexDigit(hash[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        entry.digest[i] = (u8)(hi << 4 | lo);
+    }
+
+    if (!variantFromName(variant.c_str(), entry.info.variant) ||
+        !quirksFromName(quirks.c_str(), entry.info.quirks))
+    {
+        return false;
+    }
+    entry.info.cycles_per_frame = (u16)cycles;
+
+    for (int i = 0; i < KEYPAD_SIZE; i++)
+        entry.info.keymap[i] = (u8)i;
+    if (in >> keymap)
+    {
+        if (keymap.size() != KEYPAD_SIZE)
+            return false;
+        for (int i = 0; i < KEYPAD_SIZE; i++)
+        {
+            int key = hexDigit(keymap[i]);
+            if (key < 0)
+                return false;
+            entry.info.keymap[i] = (u8)key;
+        }
+    }
+    return true;
+}
+
+static int build(const char *list_path, const char *out_path)
+{
+    std::ifstream list(list_path);
+    if (!list.is_open())
+    {
+        std::cerr << "[FAILED] Couldn't open " << list_path << "\n";
+        return 1;
+    }
+
+    std::vector<RomEntry> entries;
+    std::string line;
+    for (int number = 1; std::getline(list, line); number++)
+    {
+        // everything after # is a comment
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        RomEntry entry;
+        if (!parseLine(line, entry))
+        {
+            std::cerr << "[FAILED] " << list_path << ":" << number << ": invalid line\n";
+            return 1;
+        }
+        entries.push_back(entry);
+    }
+
+    if (!RomDatabase::build(out_path, entries))
+    {
+        std::cerr << "[FAILED] Couldn't write " << out_path << "\n";
+        return 1;
+    }
+    std::cout << "[OK] " << entries.size() << " ROMs written to " << out_path << "\n";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && strcmp(argv[1], "hash") == 0)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            u8 digest[SHA1_SIZE];
+            if (!hashFile(argv[i], digest))
+            {
+                std::cerr << "[FAILED] Couldn't read " << argv[i] << "\n";
+                return 1;
+            }
+            for (int j = 0; j < SHA1_SIZE; j++)
+                printf("%02x", digest[j]);
+            printf("  %s\n", argv[i]);
+        }
+        return 0;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "build") == 0)
+    {
+        return build(argv[2], argv[3]);
+    }
+
+    if (argc >= 4 && strcmp(argv[1], "find") == 0)
+    {
+        RomDatabase database;
+        if (!database.open(argv[2]))
+        {
+            std::cerr << "[FAILED] Couldn't open the index " << argv[2] << "\n";
+            return 1;
+        }
+        for (int i = 3; i < argc; i++)
+        {
+            u8 digest[SHA1_SIZE];
+            RomInfo info;
+            if (!hashFile(argv[i], digest))
+            {
+                std::cerr << "[FAILED] Couldn't read " << argv[i] << "\n";
+                return 1;
+            }
+            if (!database.lookup(digest, info))
+            {
+                printf("%s: not in the index\n", argv[i]);
+                continue;
+            }
+            printf("%s: %s %s %u ", argv[i], variant_names[(int)info.variant],
+                   quirks_names[(int)info.quirks], (unsigned)info.cycles_per_frame);
+            for (int j = 0; j < KEYPAD_SIZE; j++)
+                printf("%X", info.keymap[j]);
+            printf("\n");
+        }
+        return 0;
+    }
+
+    std::cerr << "usage: romdb hash <rom>...\n"
+              << "       romdb build <list.txt> <out.db>\n"
+              << "       romdb find <index.db> <rom>...\n";
+    return 1;
+}
\ No newline at end of file